@@ -0,0 +1,124 @@
+#include "assetloader.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+
+AssetLoader::AssetLoader(AssetPack const * pack) : jobs(), pack(pack), packedSounds(false)
+{
+}
+
+void AssetLoader::add(Sprite & sprite, char const * fileName, glm::ivec2 origin)
+{
+	jobs.push_back(Job { fileName, &sprite, origin, nullptr, nullptr, nullptr, std::string() });
+}
+
+void AssetLoader::add(Sound & sound, char const * fileName)
+{
+	jobs.push_back(Job { fileName, nullptr, glm::ivec2(), &sound, nullptr, nullptr, std::string() });
+}
+
+void AssetLoader::decode(Job & job)
+{
+	auto const * blob = (pack != nullptr) ? pack->find(job.fileName) : nullptr;
+	if(blob != nullptr && blob->kind == PackEntry::ImageData && job.sprite != nullptr)
+	{
+		// The surface only points into the pack, nothing is copied
+		job.surface = SDL_CreateRGBSurfaceWithFormatFrom(
+			const_cast<uint8_t *>(blob->data),
+			blob->width, blob->height, 32, blob->width * 4,
+			SDL_PIXELFORMAT_ARGB8888);
+		if(job.surface == nullptr)
+			job.error = SDL_GetError();
+	}
+	else if(blob != nullptr && blob->kind == PackEntry::SoundData && job.sound != nullptr && packedSounds)
+	{
+		// Plays straight from the pack, Mix_FreeChunk() leaves the samples alone
+		job.chunk = Mix_QuickLoad_RAW(const_cast<Uint8 *>(blob->data), Uint32(blob->size));
+		if(job.chunk == nullptr)
+			job.error = Mix_GetError();
+	}
+	else if(job.sprite != nullptr)
+	{
+		job.surface = IMG_Load(job.fileName.c_str());
+		if(job.surface == nullptr)
+			job.error = IMG_GetError();
+	}
+	else
+	{
+		job.chunk = Mix_LoadWAV(job.fileName.c_str());
+		if(job.chunk == nullptr)
+			job.error = Mix_GetError();
+	}
+}
+
+std::vector<Image> AssetLoader::load(Progress const & progress)
+{
+	auto const start = SDL_GetPerformanceCounter();
+
+	packedSounds = (pack != nullptr) && pack->sounds_match_mixer();
+
+	std::mutex mutex;
+	std::condition_variable finished_cv;
+	std::deque<size_t> finished;
+	std::atomic<size_t> next(0);
+
+	auto worker = [&]()
+	{
+		while(true)
+		{
+			auto const i = next++;
+			if(i >= jobs.size())
+				break;
+			decode(jobs[i]);
+
+			std::lock_guard<std::mutex> _l(mutex);
+			finished.push_back(i);
+			finished_cv.notify_one();
+		}
+	};
+
+	size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, jobs.size());
+	std::vector<std::thread> threads;
+	for(size_t i = 0; i < threadCount; i++)
+		threads.emplace_back(worker);
+
+	AtlasBuilder atlas;
+	size_t done = 0;
+	while(done < jobs.size())
+	{
+		std::deque<size_t> batch;
+		{
+			std::unique_lock<std::mutex> _l(mutex);
+			finished_cv.wait(_l, [&]() { return !finished.empty(); });
+			batch.swap(finished);
+		}
+		for(auto i : batch)
+		{
+			auto & job = jobs[i];
+			if(!job.error.empty())
+				die(job.error.c_str());
+			if(job.sprite != nullptr)
+				atlas.add(*job.sprite, job.surface, job.origin);
+			else
+				*job.sound = job.chunk;
+			done++;
+			if(progress)
+				progress(done, jobs.size());
+		}
+	}
+
+	for(auto & t : threads)
+		t.join();
+
+	auto pages = atlas.build();
+
+	auto const time = double(SDL_GetPerformanceCounter() - start) / double(SDL_GetPerformanceFrequency());
+	fprintf(stderr, "Loaded %d assets in %.1f ms\n", int(jobs.size()), 1000.0 * time);
+
+	jobs.clear();
+	return pages;
+}
@@ -0,0 +1,52 @@
+#ifndef ASSETLOADER_HPP
+#define ASSETLOADER_HPP
+
+#include "engine.h"
+#include "atlas.hpp"
+#include "pack.hpp"
+
+#include <vector>
+#include <string>
+#include <functional>
+
+// Decodes images and sounds on a pool of worker threads. Decoded images
+// are handed to an AtlasBuilder on the calling thread as they finish, the
+// texture upload happens on the calling (render) thread as well. Assets
+// found in the pack are used from it without decoding.
+class AssetLoader
+{
+public:
+	using Progress = std::function<void(size_t done, size_t total)>;
+
+private:
+	struct Job
+	{
+		std::string fileName;
+		Sprite * sprite;
+		glm::ivec2 origin;
+		Sound * sound;
+
+		SDL_Surface * surface;
+		Sound chunk;
+		std::string error;
+	};
+
+	std::vector<Job> jobs;
+	AssetPack const * pack;
+	bool packedSounds;
+
+	void decode(Job & job);
+
+public:
+	explicit AssetLoader(AssetPack const * pack = nullptr);
+	AssetLoader(AssetLoader const &) = delete;
+
+	void add(Sprite & sprite, char const * fileName, glm::ivec2 origin = glm::ivec2());
+	void add(Sound & sound, char const * fileName);
+
+	// Loads everything added so far and returns the atlas pages.
+	// progress is called on the calling thread after each finished asset.
+	std::vector<Image> load(Progress const & progress);
+};
+
+#endif // ASSETLOADER_HPP
@@ -0,0 +1,182 @@
+#include "atlas.hpp"
+#include "renderqueue.hpp"
+#include "softraster.hpp"
+
+#include <algorithm>
+
+AtlasBuilder::AtlasBuilder(int pageSize) : pageSize(pageSize), requests()
+{
+}
+
+AtlasBuilder::~AtlasBuilder()
+{
+	for(auto & req : requests)
+		SDL_FreeSurface(req.surface);
+}
+
+void AtlasBuilder::add(Sprite & sprite, char const * fileName, glm::ivec2 origin)
+{
+	auto * surface = IMG_Load(fileName);
+	if(surface == nullptr)
+		die(IMG_GetError());
+	add(sprite, surface, origin);
+}
+
+void AtlasBuilder::add(Sprite & sprite, SDL_Surface * surface, glm::ivec2 origin)
+{
+	if(surface->w + 2 > pageSize || surface->h + 2 > pageSize)
+		die("Image does not fit into an atlas page!");
+	requests.push_back(Request { &sprite, surface, origin });
+}
+
+std::vector<Image> AtlasBuilder::build()
+{
+	// Simple shelf packing, tallest images first
+	std::stable_sort(
+		requests.begin(), requests.end(),
+		[](Request const & l, Request const & r)
+		{
+			return l.surface->h > r.surface->h;
+		});
+
+	std::vector<Image> pages;
+	SDL_Surface * page = nullptr;
+	glm::ivec2 cursor;
+	int shelfHeight = 0;
+	size_t pageStart = 0;
+
+	auto finish_page = [&](size_t end)
+	{
+		auto * tex = SDL_CreateTextureFromSurface(renderer, page);
+		if(tex == nullptr)
+			die(SDL_GetError());
+		SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+		if(softRaster != nullptr)
+			softRaster->add_image(tex, page);
+		SDL_FreeSurface(page);
+		page = nullptr;
+
+		for(size_t i = pageStart; i < end; i++)
+			requests[i].sprite->texture = tex;
+		pages.push_back(tex);
+		pageStart = end;
+	};
+
+	for(size_t i = 0; i < requests.size(); i++)
+	{
+		auto & req = requests[i];
+		glm::ivec2 const size(req.surface->w, req.surface->h);
+
+		// One pixel of padding on each side
+		if(page != nullptr && cursor.x + size.x + 2 > pageSize)
+		{
+			cursor = glm::ivec2(0, cursor.y + shelfHeight);
+			shelfHeight = 0;
+		}
+		if(page != nullptr && cursor.y + size.y + 2 > pageSize)
+			finish_page(i);
+		if(page == nullptr)
+		{
+			page = SDL_CreateRGBSurfaceWithFormat(0, pageSize, pageSize, 32, SDL_PIXELFORMAT_ARGB8888);
+			if(page == nullptr)
+				die(SDL_GetError());
+			cursor = glm::ivec2(0, 0);
+			shelfHeight = 0;
+		}
+
+		SDL_Rect dest { cursor.x + 1, cursor.y + 1, size.x, size.y };
+		SDL_SetSurfaceBlendMode(req.surface, SDL_BLENDMODE_NONE);
+		SDL_BlitSurface(req.surface, nullptr, page, &dest);
+
+		auto & sprite = *req.sprite;
+		sprite.source = dest;
+		sprite.size = size;
+		sprite.origin = req.origin;
+		sprite.uv0 = glm::vec2(dest.x, dest.y) / float(pageSize);
+		sprite.uv1 = glm::vec2(dest.x + dest.w, dest.y + dest.h) / float(pageSize);
+
+		cursor.x += size.x + 2;
+		shelfHeight = std::max(shelfHeight, size.y + 2);
+	}
+	if(page != nullptr)
+		finish_page(requests.size());
+
+	for(auto & req : requests)
+		SDL_FreeSurface(req.surface);
+	requests.clear();
+
+	return pages;
+}
+
+void BlitSprite(Sprite const & sprite, glm::ivec2 pos)
+{
+	SDL_Rect rect {
+		pos.x - sprite.origin.x, pos.y - sprite.origin.y,
+		sprite.size.x, sprite.size.y
+	};
+	renderQueue.copy(sprite.texture, &sprite.source, rect);
+}
+
+void BlitSpritePortion(Sprite const & sprite, glm::ivec2 pos, SDL_Rect const & portion)
+{
+	SDL_Rect source {
+		sprite.source.x + portion.x, sprite.source.y + portion.y,
+		portion.w, portion.h
+	};
+	SDL_Rect rect { pos.x, pos.y, portion.w, portion.h };
+	renderQueue.copy(sprite.texture, &source, rect);
+}
+
+SpriteBatch::SpriteBatch() : texture(nullptr), vertices(), indices()
+{
+}
+
+SpriteBatch::~SpriteBatch()
+{
+	flush();
+}
+
+void SpriteBatch::quad(Image tex, glm::vec2 p0, glm::vec2 p1, glm::vec2 uv0, glm::vec2 uv1)
+{
+	if(tex != texture)
+	{
+		// Keeps the depth order when the queue sorts by texture
+		flush();
+		renderQueue.order_barrier();
+		texture = tex;
+	}
+
+	SDL_Color const white { 0xFF, 0xFF, 0xFF, 0xFF };
+
+	int const base = int(vertices.size());
+	vertices.push_back(SDL_Vertex { SDL_FPoint { p0.x, p0.y }, white, SDL_FPoint { uv0.x, uv0.y } });
+	vertices.push_back(SDL_Vertex { SDL_FPoint { p1.x, p0.y }, white, SDL_FPoint { uv1.x, uv0.y } });
+	vertices.push_back(SDL_Vertex { SDL_FPoint { p1.x, p1.y }, white, SDL_FPoint { uv1.x, uv1.y } });
+	vertices.push_back(SDL_Vertex { SDL_FPoint { p0.x, p1.y }, white, SDL_FPoint { uv0.x, uv1.y } });
+
+	int const corners[6] = { 0, 1, 2, 0, 2, 3 };
+	for(int i : corners)
+		indices.push_back(base + i);
+}
+
+void SpriteBatch::add(Sprite const & sprite, glm::ivec2 pos)
+{
+	glm::vec2 const p0(pos - sprite.origin);
+	quad(sprite.texture, p0, p0 + glm::vec2(sprite.size), sprite.uv0, sprite.uv1);
+}
+
+void SpriteBatch::add(Sprite const & sprite, glm::ivec2 pos, SDL_Rect const & portion)
+{
+	glm::vec2 const texel = (sprite.uv1 - sprite.uv0) / glm::vec2(sprite.size);
+	glm::vec2 const uv0 = sprite.uv0 + texel * glm::vec2(portion.x, portion.y);
+	glm::vec2 const uv1 = uv0 + texel * glm::vec2(portion.w, portion.h);
+	glm::vec2 const p0(pos);
+	quad(sprite.texture, p0, p0 + glm::vec2(portion.w, portion.h), uv0, uv1);
+}
+
+void SpriteBatch::flush()
+{
+	renderQueue.geometry(texture, vertices.data(), vertices.size(), indices.data(), indices.size());
+	vertices.clear();
+	indices.clear();
+}
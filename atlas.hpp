@@ -0,0 +1,80 @@
+#ifndef ATLAS_HPP
+#define ATLAS_HPP
+
+#include "engine.h"
+
+#include <vector>
+
+// A rectangle on a texture atlas page. Everything needed to draw the
+// sprite is cached here, so blitting never has to query the texture.
+struct Sprite
+{
+	Image texture;
+	SDL_Rect source;
+	glm::ivec2 size;
+	glm::ivec2 origin;
+	glm::vec2 uv0, uv1;
+};
+
+// Collects images and packs them into as few texture pages as possible.
+// Sprites passed to add() are filled in by build(), so they must stay
+// at the same address until then.
+class AtlasBuilder
+{
+private:
+	struct Request
+	{
+		Sprite * sprite;
+		SDL_Surface * surface;
+		glm::ivec2 origin;
+	};
+
+	int pageSize;
+	std::vector<Request> requests;
+
+public:
+	explicit AtlasBuilder(int pageSize = 256);
+	AtlasBuilder(AtlasBuilder const &) = delete;
+	~AtlasBuilder();
+
+	void add(Sprite & sprite, char const * fileName, glm::ivec2 origin = glm::ivec2());
+
+	// Takes ownership of surface
+	void add(Sprite & sprite, SDL_Surface * surface, glm::ivec2 origin = glm::ivec2());
+
+	// Packs all added images and returns the created pages
+	std::vector<Image> build();
+};
+
+// Draws the sprite so that its origin lands on pos
+void BlitSprite(Sprite const & sprite, glm::ivec2 pos);
+
+// Draws a part of the sprite, portion is relative to the sprite
+void BlitSpritePortion(Sprite const & sprite, glm::ivec2 pos, SDL_Rect const & portion);
+
+// Collects sprites into a single SDL_RenderGeometry call per atlas page.
+// Draw order is preserved, a page switch flushes the batch.
+class SpriteBatch
+{
+private:
+	Image texture;
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+
+	void quad(Image texture, glm::vec2 p0, glm::vec2 p1, glm::vec2 uv0, glm::vec2 uv1);
+
+public:
+	SpriteBatch();
+	SpriteBatch(SpriteBatch const &) = delete;
+	~SpriteBatch();
+
+	void add(Sprite const & sprite, glm::ivec2 pos);
+
+	// Adds a part of the sprite with its top left corner at pos,
+	// portion is relative to the sprite
+	void add(Sprite const & sprite, glm::ivec2 pos, SDL_Rect const & portion);
+
+	void flush();
+};
+
+#endif // ATLAS_HPP
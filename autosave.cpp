@@ -0,0 +1,117 @@
+#include "autosave.hpp"
+#include "savegame.hpp"
+
+static double to_ms(Uint64 ticks)
+{
+	return 1000.0 * double(ticks) / double(SDL_GetPerformanceFrequency());
+}
+
+Autosave::Autosave(char const * fileName) :
+	fileName(fileName),
+	mutex(), cv(),
+	state(Idle),
+	source_money(nullptr), source_garden(nullptr),
+	money(0), plants(),
+	stall(0),
+	worker()
+{
+	worker = std::thread([this]() { run(); });
+}
+
+Autosave::~Autosave()
+{
+	{
+		std::unique_lock<std::mutex> _l(mutex);
+		cv.wait(_l, [this]() { return state == Idle; });
+		state = Stopping;
+	}
+	cv.notify_all();
+	worker.join();
+}
+
+bool Autosave::begin(int32_t const & money, Garden const & garden)
+{
+	auto const start = SDL_GetPerformanceCounter();
+	{
+		std::lock_guard<std::mutex> _l(mutex);
+		if(state != Idle)
+			return false;
+		source_money = &money;
+		source_garden = &garden;
+		state = Copying;
+		stall = SDL_GetPerformanceCounter() - start;
+	}
+	cv.notify_all();
+	return true;
+}
+
+void Autosave::barrier()
+{
+	auto const start = SDL_GetPerformanceCounter();
+	std::unique_lock<std::mutex> _l(mutex);
+	if(state != Copying)
+		return;
+	cv.wait(_l, [this]() { return state != Copying; });
+	stall += SDL_GetPerformanceCounter() - start;
+}
+
+void Autosave::finish()
+{
+	std::unique_lock<std::mutex> _l(mutex);
+	cv.wait(_l, [this]() { return state == Idle; });
+}
+
+void Autosave::run()
+{
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> _l(mutex);
+			cv.wait(_l, [this]() { return state == Copying || state == Stopping; });
+			if(state == Stopping)
+				return;
+		}
+
+		// The main thread does not touch the source until we
+		// leave the Copying state, so no lock is needed here.
+		auto const start = SDL_GetPerformanceCounter();
+		money = *source_money;
+		plants.clear();
+		source_garden->gather(plants);
+
+		{
+			std::lock_guard<std::mutex> _l(mutex);
+			state = Writing;
+			source_money = nullptr;
+			source_garden = nullptr;
+		}
+		cv.notify_all();
+
+		// Dying here would exit() from this thread while the
+		// destructor waits for it, so failures are only reported
+		auto const copied = SDL_GetPerformanceCounter();
+		std::string error;
+		bool const saved = TryWriteSavegame(fileName.c_str(), money, plants, error);
+		auto const written = SDL_GetPerformanceCounter();
+
+		Uint64 mainStall;
+		{
+			std::lock_guard<std::mutex> _l(mutex);
+			state = Idle;
+			mainStall = stall;
+		}
+		cv.notify_all();
+
+		if(!saved)
+		{
+			fprintf(stderr, "Autosave failed, keeping the previous savegame: %s\n", error.c_str());
+			continue;
+		}
+		fprintf(stderr,
+			"Autosave: %d plants, snapshot %.2f ms, write %.2f ms, main thread stalled %.3f ms\n",
+			int(plants.size()),
+			to_ms(copied - start),
+			to_ms(written - copied),
+			to_ms(mainStall));
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef AUTOSAVE_HPP
+#define AUTOSAVE_HPP
+
+#include "garden.hpp"
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Saves the game on a background thread. begin() only hands the live
+// state to the worker, which copies it into a private snapshot while the
+// main thread renders. Anything that modifies the state has to call
+// barrier() first, which only blocks if that copy is not finished yet.
+class Autosave
+{
+private:
+	enum State { Idle, Copying, Writing, Stopping };
+
+	std::string fileName;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	State state;
+
+	int32_t const * source_money;
+	Garden const * source_garden;
+
+	int32_t money;
+	std::vector<Plant> plants;
+
+	// Time the main thread spent in begin() and barrier() for the
+	// current save, in performance counter ticks
+	Uint64 stall;
+
+	std::thread worker;
+
+	void run();
+
+public:
+	explicit Autosave(char const * fileName);
+	Autosave(Autosave const &) = delete;
+	~Autosave();
+
+	// Returns false if the previous save is still running
+	bool begin(int32_t const & money, Garden const & garden);
+
+	// Waits until the state passed to begin() may be modified again
+	void barrier();
+
+	// Waits until the current save is on disk
+	void finish();
+};
+
+#endif // AUTOSAVE_HPP
@@ -0,0 +1,18 @@
+TEMPLATE = app
+CONFIG += console c++14
+CONFIG -= app_bundle
+CONFIG -= qt
+
+TARGET = mlg-bake
+
+INCLUDEPATH += ..
+
+PACKAGES=sdl2 SDL2_mixer SDL2_image
+
+QMAKE_CFLAGS   += $$system(pkg-config --cflags $$PACKAGES)
+QMAKE_CXXFLAGS += $$system(pkg-config --cflags $$PACKAGES)
+QMAKE_LFLAGS   += $$system(pkg-config --libs $$PACKAGES)
+
+SOURCES += \
+    main.cpp \
+    ../pack.cpp
@@ -0,0 +1,114 @@
+// Bakes images and sounds into a single asset pack the game maps at
+// startup, so it neither opens nor decodes the files one by one.
+//
+// Run it from the repository root after changing anything in data/:
+//
+//   baker/mlg-bake data/assets.pack data/*.png data/*.wav
+//
+// The file names are stored as given and must match the names the game
+// loads them by. Sounds are converted to the mixer format the game opens
+// the audio device with; if that ever differs, the game ignores the
+// baked sounds and decodes the files instead.
+
+#include "engine.h"
+#include "pack.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <string>
+
+void die(char const * msg)
+{
+	fprintf(stderr, "DED: %s\n", msg);
+	fflush(stderr);
+	exit(EXIT_FAILURE);
+}
+
+static bool has_suffix(char const * s, char const * suffix)
+{
+	auto const n = strlen(s);
+	auto const m = strlen(suffix);
+	return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+static PackEntry bake_image(char const * fileName)
+{
+	auto * loaded = IMG_Load(fileName);
+	if(loaded == nullptr)
+		die(IMG_GetError());
+	auto * surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+	SDL_FreeSurface(loaded);
+	if(surface == nullptr)
+		die(SDL_GetError());
+
+	PackEntry entry { PackEntry::ImageData, fileName, surface->w, surface->h, std::vector<uint8_t>() };
+	entry.data.resize(size_t(surface->w) * size_t(surface->h) * 4);
+	SDL_LockSurface(surface);
+	for(int y = 0; y < surface->h; y++)
+	{
+		memcpy(
+			entry.data.data() + size_t(y) * size_t(surface->w) * 4,
+			static_cast<uint8_t const *>(surface->pixels) + y * surface->pitch,
+			size_t(surface->w) * 4);
+	}
+	SDL_UnlockSurface(surface);
+	SDL_FreeSurface(surface);
+	return entry;
+}
+
+static PackEntry bake_sound(char const * fileName)
+{
+	// Mix_LoadWAV already converts to the format of the open device
+	auto * chunk = Mix_LoadWAV(fileName);
+	if(chunk == nullptr)
+		die(Mix_GetError());
+
+	PackEntry entry { PackEntry::SoundData, fileName, 0, 0, std::vector<uint8_t>(chunk->abuf, chunk->abuf + chunk->alen) };
+	Mix_FreeChunk(chunk);
+	return entry;
+}
+
+int main(int argc, char ** argv)
+{
+	if(argc < 3)
+	{
+		fprintf(stderr, "Usage: %s <pack> <image or sound>...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// Same format as the game, but no sound device needed
+	SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+	if(SDL_Init(SDL_INIT_AUDIO) < 0)
+		die(SDL_GetError());
+	atexit(SDL_Quit);
+	if(IMG_Init(IMG_INIT_PNG) == 0)
+		die(IMG_GetError());
+	atexit(IMG_Quit);
+	if(Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, 1024) < 0)
+		die(Mix_GetError());
+	atexit(Mix_CloseAudio);
+
+	PackAudioSpec spec { 0, 0, 0 };
+	Mix_QuerySpec(&spec.frequency, &spec.format, &spec.channels);
+
+	std::vector<PackEntry> entries;
+	size_t bytes = 0;
+	for(int i = 2; i < argc; i++)
+	{
+		if(has_suffix(argv[i], ".png"))
+			entries.push_back(bake_image(argv[i]));
+		else if(has_suffix(argv[i], ".wav"))
+			entries.push_back(bake_sound(argv[i]));
+		else
+		{
+			fprintf(stderr, "Skipping %s, only .png and .wav files are baked\n", argv[i]);
+			continue;
+		}
+		bytes += entries.back().data.size();
+	}
+
+	WritePack(argv[1], spec, entries);
+	fprintf(stderr, "Baked %lu assets, %lu bytes, into %s\n", (unsigned long)entries.size(), (unsigned long)bytes, argv[1]);
+	return 0;
+}
@@ -0,0 +1,39 @@
+TEMPLATE = app
+CONFIG += console c++14 thread
+CONFIG -= app_bundle
+CONFIG -= qt
+
+TARGET = mlg-bench
+
+# The game is linked in as is, only its main() is left out
+DEFINES += MLG_NO_MAIN
+INCLUDEPATH += ..
+
+PACKAGES=sdl2 SDL2_mixer SDL2_image
+
+QMAKE_CFLAGS   += $$system(pkg-config --cflags $$PACKAGES)
+QMAKE_CXXFLAGS += $$system(pkg-config --cflags $$PACKAGES)
+QMAKE_LFLAGS   += $$system(pkg-config --libs $$PACKAGES)
+
+SOURCES += \
+    main.cpp \
+    ../engine.cpp \
+    ../game.cpp \
+    ../particles.cpp \
+    ../atlas.cpp \
+    ../assetloader.cpp \
+    ../catalog.cpp \
+    ../savegame.cpp \
+    ../autosave.cpp \
+    ../garden.cpp \
+    ../framescheduler.cpp \
+    ../trace.cpp \
+    ../profiler.cpp \
+    ../jobsystem.cpp \
+    ../growthkernel.cpp \
+    ../voices.cpp \
+    ../resources.cpp \
+    ../text.cpp \
+    ../renderqueue.cpp \
+    ../softraster.cpp \
+    ../pack.cpp
@@ -0,0 +1,282 @@
+// Microbenchmarks for the simulation and I/O hot paths.
+//
+// Runs without a window or sound device. Start it from the repository
+// root so the game finds its data:
+//
+//   bench/mlg-bench [--quick] [filter]
+//
+// --quick stops at 100k instead of 1M elements, filter only runs the
+// benchmarks whose name contains it. Every benchmark and size prints a
+// single JSON object per line on stdout.
+
+#include "engine.h"
+#include "game.hpp"
+#include "particles.hpp"
+#include "palette.h"
+#include "growthkernel.hpp"
+#include "plant.hpp"
+#include "renderqueue.hpp"
+#include "softraster.hpp"
+
+#include <atomic>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <functional>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+static std::atomic<size_t> allocations(0);
+
+void * operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void * p = malloc(size > 0 ? size : 1);
+	if(p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void * p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void * p, size_t) noexcept
+{
+	free(p);
+}
+
+static char const * const bench_file = "bench.sav";
+
+// Every benchmark repeats until it ran for at least this long
+static double const min_time = 0.25;
+
+static char const * filter = nullptr;
+
+// Keeps the compiler from dropping results nobody looks at
+static volatile size_t sink;
+
+static double now()
+{
+	return double(SDL_GetPerformanceCounter()) / double(SDL_GetPerformanceFrequency());
+}
+
+// Calls fn repeatedly, fn returns the number of items it processed
+static void run(char const * name, size_t n, std::function<size_t()> const & fn)
+{
+	if(filter != nullptr && strstr(name, filter) == nullptr)
+		return;
+
+	// Warm up caches and let pools reach their steady size
+	fn();
+
+	uint64_t iterations = 0;
+	uint64_t items = 0;
+	size_t const allocsBefore = allocations.load();
+	double const start = now();
+	double elapsed;
+	do
+	{
+		items += fn();
+		iterations++;
+		elapsed = now() - start;
+	} while(elapsed < min_time);
+	size_t const allocs = allocations.load() - allocsBefore;
+
+	printf(
+		"{\"name\":\"%s\",\"n\":%lu,\"iterations\":%lu,"
+		"\"ns_per_iter\":%.1f,\"ns_per_item\":%.2f,\"items_per_s\":%.0f,"
+		"\"allocs_per_iter\":%.2f}\n",
+		name, (unsigned long)n, (unsigned long)iterations,
+		1e9 * elapsed / double(iterations),
+		1e9 * elapsed / double(items),
+		double(items) / elapsed,
+		double(allocs) / double(iterations));
+	fflush(stdout);
+}
+
+static void bench_garden(size_t n)
+{
+	game_populate(n, 1234);
+
+	run("game_update", n, [n]()
+	{
+		game_update();
+		return n;
+	});
+
+	// Same area game_populate() spreads the plants over
+	int const side = int(std::sqrt(16.0 * double(n)));
+	std::vector<glm::ivec2> clicks(4096);
+	for(auto & pos : clicks)
+		pos = glm::ivec2(rng(0, side), rng(0, side));
+	run("get_clicked", n, [&clicks]()
+	{
+		for(auto const & pos : clicks)
+			sink += game_pick(pos);
+		return clicks.size();
+	});
+
+	run("draw_plant", n, [n]()
+	{
+		game_redraw_garden();
+		return n;
+	});
+
+	run("game_save", n, [n]()
+	{
+		game_save_as(bench_file);
+		return n;
+	});
+
+	run("game_load", n, [n]()
+	{
+		game_load_from(bench_file);
+		return n;
+	});
+	remove(bench_file);
+}
+
+// The per-tick AoS loop game_update() used to run for every plant, and
+// the SoA kernel that now evaluates the growth of all plants at once for
+// saving. game_update itself only wakes plants that change stage.
+static void bench_growth(size_t n)
+{
+	std::vector<Plant> plants(n);
+	std::vector<float> growth(n), watering(n), growspeed(n);
+	std::vector<float> growthOut(n), wateringOut(n);
+	std::vector<uint32_t> since(n);
+	int const types = int(game_plant_type_count());
+	for(size_t i = 0; i < n; i++)
+	{
+		// Any plant type of the catalog, with lots of water so nothing
+		// runs dry while measuring
+		plants[i] = Plant { rng(0, types), glm::ivec2(), 0.0, 1e6 };
+		growth[i] = 0.0f;
+		watering[i] = 1e6f;
+		growspeed[i] = float(plants[i].type().growspeed);
+		since[i] = uint32_t(rng(0, 1000));
+	}
+
+	run("growth_reference", n, [&plants, n]()
+	{
+		size_t changes = 0;
+		for(auto & plant : plants)
+		{
+			if(plant._type < 0)
+				continue;
+			auto const & type = plant.type();
+			auto delta = std::min(plant.watering, type.growspeed);
+			if(delta > 0)
+			{
+				auto const stage = type.stage_index(plant.growth);
+				plant.growth += delta;
+				plant.watering -= delta;
+				if(type.stage_index(plant.growth) != stage)
+					changes++;
+			}
+		}
+		sink += changes;
+		return n;
+	});
+
+	std::string const name = std::string("growth_kernel_") + GrowPlantsKernel();
+	run(name.c_str(), n, [&, n]()
+	{
+		GrowPlants(
+			growth.data(), watering.data(), growspeed.data(), since.data(), 1000,
+			growthOut.data(), wateringOut.data(), n);
+		return n;
+	});
+}
+
+static void bench_particles(size_t n)
+{
+	static Color const colors[2] = { Color { BLUE }, Color { GREEN } };
+
+	ParticlePool pool(n);
+	auto const init = [](Particle & p)
+	{
+		p.pos = glm::vec2(rng(0.0f, 80.0f), rng(0.0f, 60.0f));
+		p.vel = glm::vec2(rng(-0.2f, 0.2f), rng(-0.2f, 0.2f));
+		p.accel = glm::vec2(0.0f, 0.01f);
+		p.color = colors[rng(0, 2)];
+		p.lifespan = 1 << 30;
+	};
+
+	run("emit", n, [&pool, &init, n]()
+	{
+		pool.clear();
+		pool.emit(int(n), init);
+		return n;
+	});
+
+	pool.clear();
+	pool.emit(int(n), init);
+	run("particles_update", n, [&pool, n]()
+	{
+		pool.update();
+		return n;
+	});
+
+	ParticleSnapshot snapshot;
+	run("particles_snapshot", n, [&pool, &snapshot, n]()
+	{
+		pool.snapshot(snapshot);
+		return n;
+	});
+
+	run("particles_draw", n, [&snapshot, n]()
+	{
+		snapshot.draw();
+		renderQueue.submit();
+		return n;
+	});
+
+	// The same frame through the palette-indexed rasterizer
+	SoftRaster raster(80, 60);
+	softRaster = &raster;
+	run("particles_raster", n, [&snapshot, &raster, n]()
+	{
+		snapshot.draw();
+		renderQueue.submit();
+		raster.present();
+		return n;
+	});
+	softRaster = nullptr;
+}
+
+int main(int argc, char ** argv)
+{
+	size_t maxSize = 1000000;
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--quick") == 0)
+			maxSize = 100000;
+		else
+			filter = argv[i];
+	}
+
+	InitHeadless();
+
+	remove(bench_file);
+	GameOptions options;
+	options.save_file = bench_file;
+	options.persistent = false;
+	options.hot_reload = false;
+	game_init(options);
+
+	for(size_t n = 1000; n <= maxSize; n *= 10)
+	{
+		bench_garden(n);
+		bench_growth(n);
+		bench_particles(n);
+	}
+
+	game_shutdown();
+	return 0;
+}
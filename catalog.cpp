@@ -0,0 +1,110 @@
+#include "catalog.hpp"
+
+#include <cmath>
+#include <limits>
+
+// Keeps the lookup table small even for odd thresholds
+static size_t const max_lut_size = 4096;
+
+void PlantType::build_stage_lut()
+{
+	// Pick the bucket size so that (nearly) every bucket contains at
+	// most one stage threshold.
+	double gap = std::numeric_limits<double>::max();
+	for(size_t i = 1; i < stages.size(); i++)
+	{
+		auto d = stages[i].growth - stages[i - 1].growth;
+		if(d > 0.0)
+			gap = std::min(gap, d);
+	}
+	auto const last = stages.back().growth;
+
+	lut_scale = 1.0;
+	if(gap < std::numeric_limits<double>::max())
+		lut_scale = 1.0 / gap;
+	if(last * lut_scale >= double(max_lut_size))
+		lut_scale = double(max_lut_size - 1) / last;
+
+	stage_lut.assign(size_t(std::ceil(last * lut_scale)), 0);
+	for(size_t bucket = 0; bucket < stage_lut.size(); bucket++)
+	{
+		auto const growth = double(bucket) / lut_scale;
+		uint16_t index = 0;
+		for(size_t i = 0; i < stages.size(); i++)
+		{
+			if(growth >= stages[i].growth)
+				index = uint16_t(i);
+		}
+		stage_lut[bucket] = index;
+	}
+}
+
+std::vector<PlantType> LoadCatalog(char const * fileName)
+{
+	FILE * f = fopen(fileName, "r");
+	if(f == nullptr)
+		die("Could not open plant catalog");
+
+	std::vector<PlantType> types;
+
+	char line[512];
+	int lineNo = 0;
+
+	auto syntax_error = [&]()
+	{
+		fprintf(stderr, "%s:%d: invalid catalog entry\n", fileName, lineNo);
+		die("Failed to load plant catalog!");
+	};
+
+	while(fgets(line, sizeof line, f) != nullptr)
+	{
+		lineNo++;
+
+		char keyword[16];
+		if(sscanf(line, "%15s", keyword) != 1 || keyword[0] == '#')
+			continue;
+
+		char text[256];
+		if(strcmp(keyword, "plant") == 0)
+		{
+			PlantType type { };
+			if(sscanf(line, "%*s %255s %lf %d %d", text, &type.growspeed, &type.buyprice, &type.sellprice) != 4)
+				syntax_error();
+			type.name = text;
+			types.push_back(type);
+		}
+		else if(strcmp(keyword, "stage") == 0)
+		{
+			GrowStage stage { };
+			if(types.empty())
+				syntax_error();
+			if(sscanf(line, "%*s %lf %d %d %255s", &stage.growth, &stage.origin.x, &stage.origin.y, text) != 4)
+				syntax_error();
+			stage.image = text;
+
+			auto & stages = types.back().stages;
+			if(!stages.empty() && stage.growth < stages.back().growth)
+				syntax_error();
+			stages.push_back(stage);
+		}
+		else
+		{
+			syntax_error();
+		}
+	}
+	fclose(f);
+
+	if(types.empty())
+		die("Plant catalog is empty!");
+	for(auto & type : types)
+	{
+		if(type.stages.empty())
+			die("Plant catalog contains a plant without stages!");
+		// The garden caches stage indices in a byte per plant
+		if(type.stages.size() > 256)
+			die("Plant catalog contains a plant with more than 256 stages!");
+		type.build_stage_lut();
+	}
+
+	return types;
+}
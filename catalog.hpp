@@ -0,0 +1,57 @@
+#ifndef CATALOG_HPP
+#define CATALOG_HPP
+
+#include "engine.h"
+#include "resources.hpp"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+struct GrowStage
+{
+	double growth;
+	glm::ivec2 origin;
+	std::string image;
+	Handle<Sprite> sprite;
+};
+
+struct PlantType
+{
+	std::string name;
+	double growspeed;
+	int buyprice;
+	int sellprice;
+	std::vector<GrowStage> stages;
+
+	// stage_lut[int(growth * lut_scale)] is the last stage starting
+	// in that growth bucket, see build_stage_lut()
+	double lut_scale;
+	std::vector<uint16_t> stage_lut;
+
+	void build_stage_lut();
+
+	size_t stage_index(double growth) const
+	{
+		if(growth <= 0.0)
+			return 0;
+		auto bucket = size_t(growth * lut_scale);
+		if(bucket >= stage_lut.size())
+			return stages.size() - 1;
+		size_t index = stage_lut[bucket];
+		// Only taken when two thresholds share a bucket
+		while(index + 1 < stages.size() && growth >= stages[index + 1].growth)
+			index++;
+		return index;
+	}
+
+	GrowStage const & stage(double growth) const
+	{
+		return stages[stage_index(growth)];
+	}
+};
+
+// Loads all plant types from a catalog file, dies on errors
+std::vector<PlantType> LoadCatalog(char const * fileName);
+
+#endif // CATALOG_HPP
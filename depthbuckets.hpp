@@ -0,0 +1,120 @@
+#ifndef DEPTHBUCKETS_HPP
+#define DEPTHBUCKETS_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// Keeps ids in back-to-front render order. Every row (y coordinate) has
+// its own bucket sorted by x, so inserting and removing only touches a
+// single row and iterating yields the ids in depth order.
+class DepthBuckets
+{
+private:
+	struct Entry
+	{
+		uint32_t id;
+		int x;
+
+		bool operator<(Entry const & other) const
+		{
+			return x < other.x;
+		}
+	};
+
+	int firstRow;
+	std::vector<std::vector<Entry>> rows;
+
+	std::vector<Entry> * row(int y)
+	{
+		if(y < firstRow || y >= firstRow + int(rows.size()))
+			return nullptr;
+		return &rows[size_t(y - firstRow)];
+	}
+
+public:
+	DepthBuckets() : firstRow(0), rows()
+	{
+	}
+
+	void clear()
+	{
+		firstRow = 0;
+		rows.clear();
+	}
+
+	void insert(uint32_t id, int x, int y)
+	{
+		if(rows.empty())
+		{
+			firstRow = y;
+		}
+		else if(y < firstRow)
+		{
+			rows.insert(rows.begin(), size_t(firstRow - y), std::vector<Entry>());
+			firstRow = y;
+		}
+		if(y >= firstRow + int(rows.size()))
+			rows.resize(size_t(y - firstRow + 1));
+
+		auto & list = rows[size_t(y - firstRow)];
+		Entry const e { id, x };
+		list.insert(std::upper_bound(list.begin(), list.end(), e), e);
+	}
+
+	void remove(uint32_t id, int y)
+	{
+		auto * list = row(y);
+		if(list == nullptr)
+			return;
+		auto it = std::find_if(
+			list->begin(), list->end(),
+			[id](Entry const & e) { return e.id == id; });
+		if(it != list->end())
+			list->erase(it);
+	}
+
+	// Renames an entry, used when the external storage moves an element.
+	void renumber(uint32_t from, uint32_t to, int y)
+	{
+		auto * list = row(y);
+		if(list == nullptr)
+			return;
+		for(auto & e : *list)
+		{
+			if(e.id == from)
+			{
+				e.id = to;
+				return;
+			}
+		}
+	}
+
+	// Calls fn(id) for all ids, back to front
+	template<typename F>
+	void for_each(F && fn) const
+	{
+		for(auto const & list : rows)
+		{
+			for(auto const & e : list)
+				fn(e.id);
+		}
+	}
+
+	// Calls fn(id) for all ids with x0 <= x < x1 and y0 <= y < y1, back to front
+	template<typename F>
+	void for_each_in(int x0, int x1, int y0, int y1, F && fn) const
+	{
+		y0 = std::max(y0, firstRow);
+		y1 = std::min(y1, firstRow + int(rows.size()));
+		for(int y = y0; y < y1; y++)
+		{
+			auto const & list = rows[size_t(y - firstRow)];
+			auto it = std::lower_bound(list.begin(), list.end(), Entry { 0, x0 });
+			for(; it != list.end() && it->x < x1; it++)
+				fn(it->id);
+		}
+	}
+};
+
+#endif // DEPTHBUCKETS_HPP
@@ -1,5 +1,19 @@
 #include "engine.h"
 #include "game.hpp"
+#include "framescheduler.hpp"
+#include "trace.hpp"
+#include "profiler.hpp"
+#include "voices.hpp"
+#include "renderqueue.hpp"
+#include "spscqueue.hpp"
+#include "softraster.hpp"
+
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <functional>
 
 SDL_Renderer * renderer;
 SDL_Window * window;
@@ -11,11 +25,36 @@ void die(char const * msg)
 	exit(EXIT_FAILURE);
 }
 
-static bool wants_quit = false;
+static std::atomic<bool> wants_quit(false);
 
 static glm::ivec2 screen_size;
 
-int main()
+static uint32_t rng_state = 0x9E3779B9;
+
+void rng_seed(uint32_t seed)
+{
+	// xorshift must never be seeded with zero
+	rng_state = (seed != 0) ? seed : 0x9E3779B9;
+}
+
+uint32_t rng_next()
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+// About 6 ms of latency at 44.1 kHz, --audio-buffer overrides it
+static int audio_buffer = 256;
+static int voice_count = 16;
+
+static std::unique_ptr<VoiceManager> voices;
+
+// Only set with --software
+static std::unique_ptr<SoftRaster> raster;
+
+static void init_sdl()
 {
 	if(SDL_Init(SDL_INIT_EVERYTHING) < 0)
 		die(SDL_GetError());
@@ -25,13 +64,182 @@ int main()
 		die(IMG_GetError());
 	atexit(IMG_Quit);
 
-	if(Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, 1024) < 0)
-		die(Mix_GetError());
+	if(Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, audio_buffer) < 0)
+	{
+		// Not every driver manages small buffers
+		fprintf(stderr, "Audio buffer of %d samples failed, using 1024: %s\n", audio_buffer, Mix_GetError());
+		if(Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, 1024) < 0)
+			die(Mix_GetError());
+	}
 	atexit(Mix_CloseAudio);
 
+	voices.reset(new VoiceManager(voice_count));
+
 	if(Mix_Init(MIX_INIT_MP3) == 0)
 		die(Mix_GetError());
 	atexit(Mix_Quit);
+}
+
+static SDL_Surface * headless_surface;
+
+void InitHeadless()
+{
+	// No display and no sound device needed
+	SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+	SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+	init_sdl();
+
+	// Textures still have to be created, so render into a surface
+	headless_surface = SDL_CreateRGBSurfaceWithFormat(0, 80, 60, 32, SDL_PIXELFORMAT_ARGB8888);
+	if(headless_surface == nullptr)
+		die(SDL_GetError());
+	renderer = SDL_CreateSoftwareRenderer(headless_surface);
+	if(renderer == nullptr)
+		die(SDL_GetError());
+	atexit([]()
+	{
+		SDL_DestroyRenderer(renderer);
+		SDL_FreeSurface(headless_surface);
+	});
+
+	screen_size = glm::ivec2(80, 60);
+}
+
+#ifndef MLG_NO_MAIN
+
+static double seconds_since(Uint64 start)
+{
+	return double(SDL_GetPerformanceCounter() - start) / double(SDL_GetPerformanceFrequency());
+}
+
+// Runs a recorded session as fast as possible without rendering
+static void replay(char const * traceFile)
+{
+	TraceReader trace(traceFile);
+	rng_seed(trace.seed());
+	screen_size = trace.screen();
+
+	uint64_t tick = 0;
+	uint64_t eventTick = 0;
+	SDL_Event e;
+	bool more = trace.next(eventTick, e, screen_size);
+
+	auto const start = SDL_GetPerformanceCounter();
+	while(true)
+	{
+		while(more && eventTick <= tick)
+		{
+			game_do_event(e);
+			more = trace.next(eventTick, e, screen_size);
+		}
+		if(!more && tick >= trace.end())
+			break;
+		game_update();
+		voices->flush();
+		tick++;
+	}
+	auto const duration = seconds_since(start);
+
+	fprintf(stderr, "Replay: %lu ticks in %.1f ms, %.0f ticks/s\n",
+		(unsigned long)tick, 1000.0 * duration, double(tick) / duration);
+	printf("%016llx\n", (unsigned long long)game_state_hash());
+}
+
+// An event and the window size it refers to, on its way from the
+// main thread to the simulation thread
+struct InputEvent
+{
+	SDL_Event event;
+	glm::ivec2 screen;
+};
+
+static SpscQueue<InputEvent, 1024> inputs;
+
+// Performance counter of the latest game_publish()
+static std::atomic<Uint64> last_publish;
+
+// Runs the game at 60 ticks per second until quit() and publishes the
+// state after every batch of ticks
+static void simulate(TraceWriter * trace, uint64_t & tick)
+{
+	// At most 5 ticks in a row, then time is dropped
+	FrameScheduler ticker(60.0, 5, 60.0);
+	do
+	{
+		{
+			PROFILE_SCOPE("input");
+			InputEvent input;
+			while(inputs.pop(input))
+			{
+				screen_size = input.screen;
+				if(trace != nullptr)
+					trace->event(tick, input.event, screen_size);
+				game_do_event(input.event);
+			}
+		}
+
+		int ticks = ticker.begin_frame();
+		for(; ticks > 0; ticks--, tick++)
+		{
+			PROFILE_SCOPE("game_update");
+			game_update();
+		}
+
+		// Sounds of these events and ticks, each at most once
+		voices->flush();
+
+		game_publish();
+		last_publish = SDL_GetPerformanceCounter();
+
+		ticker.wait_for_present();
+		ticker.end_frame();
+	} while(!wants_quit);
+
+	ticker.report("Ticks");
+}
+
+int main(int argc, char ** argv)
+{
+	auto const startup = SDL_GetPerformanceCounter();
+
+	bool vsync = false;
+	bool software = false;
+	char const * recordFile = nullptr;
+	char const * replayFile = nullptr;
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--vsync") == 0)
+			vsync = true;
+		else if(strcmp(argv[i], "--software") == 0)
+			software = true;
+		else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			recordFile = argv[++i];
+		else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+			replayFile = argv[++i];
+		else if(strcmp(argv[i], "--audio-buffer") == 0 && i + 1 < argc)
+			audio_buffer = std::max(64, atoi(argv[++i]));
+		else if(strcmp(argv[i], "--voices") == 0 && i + 1 < argc)
+			voice_count = std::max(1, atoi(argv[++i]));
+	}
+
+	if(replayFile != nullptr)
+	{
+		InitHeadless();
+
+		GameOptions options;
+		options.persistent = false;
+		options.hot_reload = false;
+		std::string const saveFile = std::string(replayFile) + ".sav";
+		options.save_file = saveFile.c_str();
+		game_init(options);
+
+		replay(replayFile);
+
+		game_shutdown();
+		return 0;
+	}
+
+	init_sdl();
 
 	window = SDL_CreateWindow(
 		"My Little Garden - Growing Plants Is Magic!",
@@ -40,70 +248,145 @@ int main()
 		SDL_WINDOW_SHOWN);
 	if(window == nullptr)
 		die(SDL_GetError());
+	SDL_GetWindowSize(window, &screen_size.x, &screen_size.y);
+
+	// The software rasterizer only needs to upload and scale one texture,
+	// which any renderer can do, SDL's own software renderer included.
+	Uint32 rendererFlags = software ? 0 : (SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+	if(vsync)
+		rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
 
 	renderer = SDL_CreateRenderer(
 		window,
 		-1,
-		SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+		rendererFlags);
 	if(renderer == nullptr)
 		die(SDL_GetError());
 
-	SDL_Texture * renderTarget = CreateRenderTarget(80, 60);
+	SDL_Texture * renderTarget = nullptr;
+	if(software)
+	{
+		raster.reset(new SoftRaster(80, 60));
+		softRaster = raster.get();
+	}
+	else
+	{
+		renderTarget = CreateRenderTarget(80, 60);
+	}
 
 	SDL_ShowCursor(0);
 
-	game_init();
+	game_init(GameOptions());
 
-	auto next_update = SDL_GetTicks();
-	auto const frametime = 1000.0 / 60.0;
-	auto const sleeptime = 10;
+	// Recording starts from a copy of the current garden, so the
+	// replay does not depend on the savegame changing later on.
+	std::unique_ptr<TraceWriter> trace;
+	uint64_t tick = 0;
+	if(recordFile != nullptr)
+	{
+		uint32_t const seed = uint32_t(SDL_GetPerformanceCounter());
+		rng_seed(seed);
+		game_save_as((std::string(recordFile) + ".sav").c_str());
+		trace.reset(new TraceWriter(recordFile, seed, screen_size));
+	}
+
+	fprintf(stderr, "Startup took %.1f ms\n", 1000.0 * seconds_since(startup));
+
+	// The simulation runs on its own thread, so a slow present never
+	// delays a tick and a slow tick never delays a frame.
+	last_publish = SDL_GetPerformanceCounter();
+	std::thread simulation(simulate, trace.get(), std::ref(tick));
+
+	// With vsync the display paces the frames, otherwise aim for 60
+	// frames per second. Ticks are left to the simulation thread.
+	FrameScheduler scheduler(60.0, 5, vsync ? 0.0 : 60.0);
+	auto const tickLength = double(SDL_GetPerformanceFrequency()) / 60.0;
+	glm::ivec2 windowSize = screen_size;
 	do
 	{
-		SDL_Event e;
-		while(SDL_PollEvent(&e))
 		{
-			if(e.type == SDL_QUIT)
-				quit();
-
-			if(e.type == SDL_WINDOWEVENT)
+			PROFILE_SCOPE("events");
+			SDL_Event e;
+			while(SDL_PollEvent(&e))
 			{
-				SDL_GetWindowSize(window, &screen_size.x, &screen_size.y);
+				if(e.type == SDL_QUIT)
+					quit();
+
+				if(e.type == SDL_WINDOWEVENT)
+				{
+					SDL_GetWindowSize(window, &windowSize.x, &windowSize.y);
+				}
+
+				// Profiler hotkeys are handled here, so they neither
+				// stall a tick nor end up in the trace
+				if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3)
+				{
+					game_toggle_profiler();
+					continue;
+				}
+				if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F4)
+				{
+					auto const written = ProfileExport("profile.json", 10.0);
+					fprintf(stderr, "Wrote %lu profile markers to profile.json\n", (unsigned long)written);
+					continue;
+				}
+
+				// Only fails when the simulation is hopelessly behind
+				inputs.push(InputEvent { e, windowSize });
 			}
-
-			game_do_event(e);
 		}
 
-		auto now = SDL_GetTicks();
-		while(next_update < now)
 		{
-			game_update();
-			next_update += frametime;
+			PROFILE_SCOPE("game_render");
+			auto const since = double(SDL_GetPerformanceCounter() - last_publish);
+			game_render(float(std::min(1.0, since / tickLength)));
 		}
-
 		{
+			PROFILE_SCOPE("submit");
 			RenderTargetGuard _g(renderTarget);
-			game_render();
+			renderQueue.submit();
 		}
 
 		SDL_RenderCopy(
 			renderer,
-			renderTarget,
+			software ? raster->present() : renderTarget,
 			nullptr,
 			nullptr);
 
-		SDL_RenderPresent(renderer);
-
-		SDL_Delay(sleeptime);
+		{
+			PROFILE_SCOPE("sleep");
+			scheduler.wait_for_present();
+		}
+		{
+			PROFILE_SCOPE("present");
+			SDL_RenderPresent(renderer);
+		}
+		scheduler.end_frame();
+		ProfileFrame();
 	} while(!wants_quit);
 
+	simulation.join();
+	scheduler.report();
+
+	if(trace)
+	{
+		trace->finish(tick);
+		fprintf(stderr, "Recorded %lu ticks to %s\n", (unsigned long)tick, recordFile);
+		printf("%016llx\n", (unsigned long long)game_state_hash());
+	}
+
 	game_shutdown();
 
+	softRaster = nullptr;
+	raster.reset();
+
 	SDL_DestroyRenderer(renderer);
 	SDL_DestroyWindow(window);
 
 	return 0;
 }
 
+#endif // MLG_NO_MAIN
 
 void quit()
 {
@@ -133,13 +416,17 @@ Image LoadImage(char const * fileName)
 
 Image CreateRenderTarget(int w, int h)
 {
+	// The software rasterizer draws into its own copy, the texture is
+	// only a handle then and never needs to be a target
 	auto * tex = SDL_CreateTexture(
 			renderer,
 			SDL_PIXELFORMAT_ARGB8888,
-			SDL_TEXTUREACCESS_TARGET,
+			(softRaster != nullptr) ? SDL_TEXTUREACCESS_STATIC : SDL_TEXTUREACCESS_TARGET,
 			w, h);
 	if(tex == nullptr)
 		die(SDL_GetError());
+	if(softRaster != nullptr)
+		softRaster->add_target(tex, w, h);
 	return tex;
 }
 
@@ -156,21 +443,13 @@ void BlitImage(Image texture, glm::ivec2 pos)
 
 	SDL_QueryTexture(texture, nullptr, nullptr, &rect.w, &rect.h);
 
-	SDL_RenderCopy(
-		renderer,
-		texture,
-		nullptr,
-		&rect);
+	renderQueue.copy(texture, nullptr, rect);
 }
 
 void BlitImagePortion(Image texture, glm::ivec2 pos, SDL_Rect const & portion)
 {
 	SDL_Rect rect { pos.x, pos.y, portion.w, portion.h };
-	SDL_RenderCopy(
-		renderer,
-		texture,
-		&portion,
-		&rect);
+	renderQueue.copy(texture, &portion, rect);
 }
 
 
@@ -190,11 +469,19 @@ Music LoadMusic(char const * fileName)
 	return mus;
 }
 
+void ConfigureSound(Sound sound, int priority, int maxVoices)
+{
+	voices->configure(sound, priority, maxVoices);
+}
+
 void PlaySound(Sound sound)
 {
-	if(sound == nullptr)
-		return;
-	Mix_PlayChannel(-1, sound, 0);
+	voices->play(sound);
+}
+
+void ReplaceSound(Sound sound, Sound chunk)
+{
+	voices->replace(sound, chunk);
 }
 
 void PlayMusic(Music music)
@@ -16,6 +16,10 @@ using Image = SDL_Texture * ;
 
 void quit();
 
+// Sets up SDL without a window or sound device. Rendering goes to an
+// offscreen 80x60 surface. Used for replays and benchmarks.
+void InitHeadless();
+
 [[noreturn]] void die(char const * msg);
 
 glm::vec2 map_to_screen(glm::vec2 pos);
@@ -31,8 +35,18 @@ void BlitImagePortion(Image, glm::ivec2 pos, SDL_Rect const &);
 Image CreateRenderTarget(int w, int h);
 
 Sound LoadSound(char const * fileName);
+
+// Higher priorities may steal the channels of lower ones, maxVoices
+// caps how many copies of a sound play at once
+void ConfigureSound(Sound sound, int priority, int maxVoices);
+
+// Starts at the end of the frame, repeated calls within a frame play once
 void PlaySound(Sound sound);
 
+// Gives sound the samples of chunk and takes ownership of chunk. Applied
+// where sounds are started, so playing voices never see it half done.
+void ReplaceSound(Sound sound, Sound chunk);
+
 Music LoadMusic(char const * fileName);
 void PlayMusic(Music music);
 
@@ -53,10 +67,15 @@ public:
 	}
 };
 
+// Deterministic random numbers. All game randomness goes through
+// these, so a session replays identically from the same seed.
+void rng_seed(uint32_t seed);
+uint32_t rng_next();
+
 template<typename T>
 static inline T rng(T min, T max)
 {
-	return min + ((max - min) * rand()) / RAND_MAX;
+	return min + T((max - min) * (rng_next() / 4294967296.0));
 }
 
 static bool contains(SDL_Rect const & rect, glm::ivec2 pos)
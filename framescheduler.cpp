@@ -0,0 +1,97 @@
+#include "framescheduler.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+FrameScheduler::FrameScheduler(double tickRate, int maxCatchUp, double frameRate) :
+	frequency(double(SDL_GetPerformanceFrequency())),
+	tickLength(frequency / tickRate),
+	frameLength(frameRate > 0.0 ? frequency / frameRate : 0.0),
+	maxCatchUp(maxCatchUp),
+	lastFrame(SDL_GetPerformanceCounter()),
+	accumulator(0.0),
+	nextPresent(double(lastFrame) + frameLength),
+	lastPresent(lastFrame),
+	frames(0),
+	intervalSum(0.0),
+	intervalSquareSum(0.0),
+	intervalMax(0.0),
+	droppedTicks(0)
+{
+}
+
+int FrameScheduler::begin_frame()
+{
+	auto const now = SDL_GetPerformanceCounter();
+	accumulator += double(now - lastFrame);
+	lastFrame = now;
+
+	int ticks = int(accumulator / tickLength);
+	if(ticks > maxCatchUp)
+	{
+		droppedTicks += unsigned(ticks - maxCatchUp);
+		ticks = maxCatchUp;
+		accumulator = double(ticks) * tickLength;
+	}
+	accumulator -= double(ticks) * tickLength;
+	return ticks;
+}
+
+float FrameScheduler::alpha() const
+{
+	return float(accumulator / tickLength);
+}
+
+void FrameScheduler::wait_for_present()
+{
+	if(frameLength <= 0.0)
+		return;
+
+	// Sleep coarsely while there is enough time left, the
+	// scheduler may oversleep by a millisecond or so.
+	while(true)
+	{
+		auto const remaining = (nextPresent - double(SDL_GetPerformanceCounter())) / frequency;
+		if(remaining <= 0.0)
+			break;
+		if(remaining > 0.002)
+			SDL_Delay(Uint32(1000.0 * remaining) - 1);
+		else
+			SDL_Delay(0);
+	}
+}
+
+void FrameScheduler::end_frame()
+{
+	auto const now = SDL_GetPerformanceCounter();
+	auto const interval = double(now - lastPresent) / frequency;
+	lastPresent = now;
+
+	frames++;
+	intervalSum += interval;
+	intervalSquareSum += interval * interval;
+	if(interval > intervalMax)
+		intervalMax = interval;
+
+	// Aim for a steady cadence, but don't try to catch up on frames
+	// that were missed completely.
+	nextPresent += frameLength;
+	if(nextPresent < double(now))
+		nextPresent = double(now) + frameLength;
+}
+
+void FrameScheduler::report(char const * what) const
+{
+	if(frames == 0)
+		return;
+	auto const mean = intervalSum / double(frames);
+	auto const variance = intervalSquareSum / double(frames) - mean * mean;
+	fprintf(stderr,
+		"%s: %lu, mean %.2f ms, jitter %.3f ms, worst %.2f ms, dropped ticks %lu\n",
+		what,
+		frames,
+		1000.0 * mean,
+		1000.0 * std::sqrt(variance > 0.0 ? variance : 0.0),
+		1000.0 * intervalMax,
+		droppedTicks);
+}
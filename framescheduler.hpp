@@ -0,0 +1,50 @@
+#ifndef FRAMESCHEDULER_HPP
+#define FRAMESCHEDULER_HPP
+
+#include <SDL.h>
+
+// Fixed-step game ticks decoupled from the frame rate.
+//
+// begin_frame() returns how many ticks are due, but never more than
+// maxCatchUp, so a long stall drops time instead of spiralling.
+// alpha() is the fraction of a tick that has passed since the last one,
+// for interpolating the rendered state. Without vsync, wait_for_present()
+// sleeps until the next target present time.
+class FrameScheduler
+{
+private:
+	double frequency;
+	double tickLength;
+	double frameLength;
+	int maxCatchUp;
+
+	Uint64 lastFrame;
+	double accumulator;
+
+	double nextPresent;
+	Uint64 lastPresent;
+
+	// Present interval statistics, in seconds
+	unsigned long frames;
+	double intervalSum;
+	double intervalSquareSum;
+	double intervalMax;
+	unsigned long droppedTicks;
+
+public:
+	// frameRate 0 disables sleeping, e.g. when presenting with vsync
+	FrameScheduler(double tickRate, int maxCatchUp, double frameRate);
+
+	int begin_frame();
+
+	float alpha() const;
+
+	void wait_for_present();
+
+	void end_frame();
+
+	// Prints the interval statistics, what names the intervals
+	void report(char const * what = "Frames") const;
+};
+
+#endif // FRAMESCHEDULER_HPP
@@ -1,10 +1,26 @@
 #include "game.hpp"
 #include "palette.h"
+#include "particles.hpp"
+#include "atlas.hpp"
+#include "resources.hpp"
+#include "text.hpp"
+#include "renderqueue.hpp"
+#include "triplebuffer.hpp"
+#include "catalog.hpp"
+#include "garden.hpp"
+#include "savegame.hpp"
+#include "autosave.hpp"
+#include "profiler.hpp"
+#include "jobsystem.hpp"
 
 #include <vector>
-#include <array>
 #include <algorithm>
-#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <string>
+#include <cmath>
+#include <mutex>
+#include <atomic>
 
 using namespace glm;
 
@@ -24,72 +40,43 @@ enum GameState
 	CatalogView
 };
 
-struct Color { Uint8 r, g, b; };
+// Declared first, so it outlives every handle below
+static ResourceCache resources;
 
-struct Particle
-{
-	int lifespan;
-	vec2 pos;
-	vec2 vel;
-	vec2 accel;
-	Color color;
-
-	Particle() : lifespan(1), pos(), vel(), accel(), color{BLUE}
-	{
-	}
-};
-
-struct GrowStage
-{
-	double growth;
-	ivec2 origin;
-	SDL_Texture * graphics;
-};
-
-struct PlantType
-{
-	char const * name;
-	double growspeed;
-	std::vector<GrowStage> stages;
-};
-
-static std::array<PlantType,5> plantTypes;
+static std::vector<PlantType> plantTypes;
 
 static Tool tool;
 static uint seedtype;
 
 static GameState gamestate;
 
-struct Plant
+PlantType const & Plant::type() const
 {
-	int _type;
-	ivec2 position;
-	double growth;
-	double watering;
-
-	PlantType const & type() const
-	{
-		return plantTypes[_type];
-	}
-};
+	return plantTypes[_type];
+}
 
 struct
 {
-	Image mouse_cursors[7];
+	Handle<Sprite> mouse_cursors[7];
 
-	Image ui_overlay;
-	Image ui_catalog;
+	Handle<Sprite> ui_overlay;
+	Handle<Sprite> ui_catalog;
 
-	Image planthole;
-	Image font;
-	Image coins;
+	Handle<Sprite> planthole;
+	Handle<Sprite> font;
+	Handle<Sprite> coins;
 } textures;
 
 struct
 {
-	Sound spray, click, dig, splash, exhume, plant, nope;
+	Handle<Sound> spray, click, dig, splash, exhume, plant, nope;
 } sounds;
 
+static Handle<Music> music;
+
+// Digits only, the upper row is the inactive style
+static std::unique_ptr<TextRenderer> text;
+
 static ivec2 tool_offsets[7] =
 {
 	ivec2(0,0),
@@ -100,351 +87,424 @@ static ivec2 tool_offsets[7] =
     ivec2(3,3),
 };
 
-static std::vector<Plant> plants;
+static Garden garden;
 
-static SDL_Texture * acreTarget;
+// Part of the screen showing the garden
+static SDL_Rect const viewport { 10, 0, 69, 59 };
 
-static glm::ivec2 mouse_pos;
-static glm::ivec2 scroll_offset;
+// Draw order of the frame. The render queue may reorder draws within a
+// layer by texture, so everything overlapping goes to its own layer.
+enum Layer
+{
+	LayerBackground,
+	LayerGarden,
+	LayerParticles,
+	LayerOverlay,
+	LayerScrollBars,
+	LayerCatalog,
+	LayerCatalogText,
+	LayerProfiler,
+	LayerProfilerText,
+	LayerCursor
+};
 
-static bool is_scrolling;
+// Sprite of one plant, as the render thread sees it
+struct PlantSprite
+{
+	Sprite const * sprite;
+	ivec2 position;
+};
 
-static std::vector<Particle> particles;
+// Part of a chunk image changed by the change numbered version
+struct DirtyRect
+{
+	SDL_Rect rect;
+	uint64_t version;
+};
 
-static int32_t player_money = 5;
+// Changes to the image of a chunk, kept by the simulation. Every change
+// gets a new version number, the render thread compares them to the
+// version its image shows. Changes up to base are not logged anymore.
+struct ChunkLog
+{
+	uint64_t version = 0;
+	uint64_t base = 0;
+	std::vector<DirtyRect> dirty;
 
-static std::array<int, plantTypes.size()> buyprice =
+	// Sprites reaching into the chunk, up to date if listed is current
+	uint64_t listed = ~uint64_t(0);
+	std::vector<PlantSprite> plants;
+};
+static std::unordered_map<uint64_t, ChunkLog> chunk_logs;
+static size_t const max_dirty_rects = 64;
+static uint64_t change_counter;
+static uint64_t all_dirty_version;
+
+// A visible chunk as of the last game_publish()
+struct ChunkView
+{
+	ivec2 coord;
+	uint64_t version;
+	uint64_t base;
+
+	// ChunkLog::listed at the time dirty and plants were copied. Every
+	// snapshot buffer has its own views, so each one tracks it.
+	uint64_t listed = ~uint64_t(0);
+	std::vector<DirtyRect> dirty;
+	std::vector<PlantSprite> plants;
+};
+
+// Everything game_render() needs, written by game_publish() on the
+// simulation thread and read on the render thread.
+struct Snapshot
+{
+	GameState gamestate;
+	Tool tool;
+	int32_t money;
+	ivec2 scroll_offset;
+	ivec2 mouse_pos;
+	uint64_t all_dirty;
+	std::vector<ChunkView> chunks;
+	ParticleSnapshot particles;
+};
+static TripleBuffer<Snapshot> snapshots;
+
+// Retained images of the chunks around the viewport, owned by the render
+// thread. Keyed like the garden chunks.
+struct ChunkImage
 {
-	2, 4, 6, 9, 11
+	Image texture;
+	bool valid;
+	uint64_t version;
+	Uint32 last_used;
 };
-static std::array<int, plantTypes.size()> sellprice =
+static std::unordered_map<uint64_t, ChunkImage> chunk_images;
+static size_t const max_chunk_images = 16;
+static Uint32 frame_counter;
+
+// Largest area any plant sprite covers, relative to the plant position
+static ivec2 sprite_reach_min;
+static ivec2 sprite_reach_max;
+
+// Size and origin of every plant stage sprite. The simulation thread uses
+// these instead of the sprites, which the render thread reloads in place.
+struct StageBounds
 {
-	3, 5, 8, 12, 15
+	ivec2 size;
+	ivec2 origin;
 };
+static std::vector<std::vector<StageBounds>> stage_bounds;
+
+// Reach and bounds after a sprite reload, measured on the render thread
+// and taken over by the simulation thread in game_update()
+static std::mutex reloaded_reach_mutex;
+static std::atomic<bool> reach_reloaded(false);
+static ivec2 reloaded_reach_min;
+static ivec2 reloaded_reach_max;
+static std::vector<std::vector<StageBounds>> reloaded_stage_bounds;
+
+static glm::ivec2 mouse_pos;
+static glm::ivec2 scroll_offset;
+
+static bool is_scrolling;
+
+static ParticlePool particles(1 << 17);
+
+static std::unique_ptr<JobSystem> jobs;
+
+// Positions of the plants that reached a new stage this tick
+static std::vector<ivec2> stage_changes;
 
-static void emit(int count, std::function<void(Particle&)> init)
+static int32_t player_money = 5;
+
+// Toggled on the render thread, see game_toggle_profiler()
+static bool show_profiler = false;
+
+static void mark_dirty(ivec2 position)
 {
-	for(int i = 0; i < count; i++)
+	SDL_Rect const rect {
+		position.x + sprite_reach_min.x,
+		position.y + sprite_reach_min.y,
+		sprite_reach_max.x - sprite_reach_min.x,
+		sprite_reach_max.y - sprite_reach_min.y,
+	};
+
+	auto const version = ++change_counter;
+	auto const lo = Garden::chunk_of(ivec2(rect.x, rect.y));
+	auto const hi = Garden::chunk_of(ivec2(rect.x + rect.w - 1, rect.y + rect.h - 1));
+	for(int y = lo.y; y <= hi.y; y++)
 	{
-		Particle p;
-		init(p);
-		particles.push_back(p);
+		for(int x = lo.x; x <= hi.x; x++)
+		{
+			auto & log = chunk_logs[Garden::key_of(ivec2(x, y))];
+			log.version = version;
+
+			// Lots of small redraws are slower than a single big one
+			if(log.dirty.size() >= max_dirty_rects)
+			{
+				log.dirty.clear();
+				log.base = version;
+			}
+			else
+			{
+				log.dirty.push_back(DirtyRect { rect, version });
+			}
+		}
 	}
 }
 
+static void mark_all_dirty()
+{
+	all_dirty_version = ++change_counter;
+}
+
+static std::string savegame_file;
+static bool persistent;
+
+// Save once a minute
+static int const autosave_interval = 60 * 60;
+
+static std::unique_ptr<Autosave> autosave;
+static int autosave_timer;
+
 bool game_has_save()
 {
-	FILE * f = fopen("savegame.dat", "rb");
-	if(f != nullptr)
-		fclose(f);
-	return (f != nullptr);
+	return HasSavegame(savegame_file.c_str());
 }
 
-void game_load()
+void game_load_from(char const * fileName)
 {
-	FILE * f = fopen("savegame.dat", "rb");
-	if(f == nullptr)
-		die("Could not open savegame.dat");
-
-	uint32_t count, magic;
-	fread(&magic, sizeof magic, 1, f);
-	if(magic != 0xBADEAFFE)
-		die("Failed to load game: Is not a badeaffe!");
-	fread(&player_money, sizeof player_money, 1, f);
-	fread(&count, sizeof count, 1, f);
-	for(uint32_t i = 0; i < count; i++)
+	std::vector<Plant> plants;
+	ReadSavegame(fileName, player_money, plants);
+	for(auto const & plant : plants)
 	{
-		Plant plant;
-		fread(&plant, sizeof(plant), 1, f);
-		plants.push_back(plant);
+		// -1 is an empty hole
+		if(plant._type < -1 || plant._type >= int(plantTypes.size()))
+			die("Failed to load game: Unknown plant type!");
 	}
-	fclose(f);
+
+	garden.assign(plants);
+	mark_all_dirty();
 }
 
-void game_save()
+void game_load()
 {
-	FILE * f = fopen("savegame.dat", "wb");
-	if(f == nullptr)
-		die("Could not open savegame.dat");
+	game_load_from(savegame_file.c_str());
+}
 
-	uint32_t count = uint32_t(plants.size());
-	uint32_t magic = 0xBADEAFFE;
+void game_save_as(char const * fileName)
+{
+	std::vector<Plant> plants;
+	garden.gather(plants);
+	WriteSavegame(fileName, player_money, plants);
+}
 
-	fwrite(&magic, sizeof magic, 1, f);
-	fwrite(&player_money, sizeof player_money, 1, f);
-	fwrite(&count, sizeof count, 1, f);
+void game_save()
+{
+	game_save_as(savegame_file.c_str());
+}
 
-	fwrite(plants.data(), sizeof(Plant), plants.size(), f);
+static void hash_bytes(uint64_t & hash, void const * data, size_t length)
+{
+	// FNV-1a
+	auto const * p = static_cast<uint8_t const *>(data);
+	for(size_t i = 0; i < length; i++)
+		hash = (hash ^ p[i]) * 0x100000001B3ull;
+}
+
+uint64_t game_state_hash()
+{
+	std::vector<Plant> plants;
+	garden.gather(plants);
+	std::sort(plants.begin(), plants.end(), [](Plant const & a, Plant const & b)
+	{
+		if(a.position.y != b.position.y)
+			return a.position.y < b.position.y;
+		if(a.position.x != b.position.x)
+			return a.position.x < b.position.x;
+		return a._type < b._type;
+	});
 
-	fclose(f);
+	uint64_t hash = 0xCBF29CE484222325ull;
+	hash_bytes(hash, &player_money, sizeof player_money);
+	hash_bytes(hash, &tool, sizeof tool);
+	hash_bytes(hash, &gamestate, sizeof gamestate);
+	hash_bytes(hash, &scroll_offset, sizeof scroll_offset);
+	for(auto const & plant : plants)
+	{
+		hash_bytes(hash, &plant._type, sizeof plant._type);
+		hash_bytes(hash, &plant.position, sizeof plant.position);
+		hash_bytes(hash, &plant.growth, sizeof plant.growth);
+		hash_bytes(hash, &plant.watering, sizeof plant.watering);
+	}
+	for(size_t i = 0; i < particles.size(); i++)
+	{
+		float const pos[2] = { particles.x(i), particles.y(i) };
+		hash_bytes(hash, pos, sizeof pos);
+	}
+	return hash;
 }
 
-void game_init()
+static void render_loading(size_t done, size_t total)
 {
-	textures.mouse_cursors[Hand] = LoadImage("data/mouse_hand.png");
-	textures.mouse_cursors[Shovel] = LoadImage("data/mouse_shovel.png");
-	textures.mouse_cursors[WateringCan] = LoadImage("data/mouse_watering_can.png");
-	textures.mouse_cursors[Pot] = LoadImage("data/mouse_pot.png");
-	textures.mouse_cursors[Fertilizer] = LoadImage("data/mouse_fertilizer.png");
-	textures.mouse_cursors[Seeds] = LoadImage("data/seeds.png");
-	textures.ui_overlay = LoadImage("data/ui_overlay.png");
-	textures.ui_catalog = LoadImage("data/catalog.png");
-	textures.planthole  = LoadImage("data/planthole.png");
-	textures.font  = LoadImage("data/font.png");
-	textures.coins = LoadImage("data/coins.png");
+	// Called before the game render target is in use, so this
+	// draws straight to the window.
+	SDL_PumpEvents();
 
-	sounds.click = LoadSound("data/click.wav");
-	sounds.dig = LoadSound("data/dig.wav");
-	sounds.splash = LoadSound("data/splash.wav");
-	sounds.spray = LoadSound("data/spray.wav");
-	sounds.exhume = LoadSound("data/exhume.wav");
-	sounds.plant = LoadSound("data/plant.wav");
-	sounds.nope = LoadSound("data/nope.wav");
+	ivec2 size;
+	SDL_GetRendererOutputSize(renderer, &size.x, &size.y);
 
-	acreTarget = CreateRenderTarget(69 + 65, 59 + 55);
+	SDL_Rect bar { size.x / 8, size.y / 2 - 8, 3 * size.x / 4, 16 };
 
-	plantTypes[0] = PlantType
-	{
-		"Insel-Brulie",
-		0.01,
-		{
-	        GrowStage {
-				0.0, ivec2(3, 11),
-				LoadImage("data/plant0_stage0.png"),
-			},
-	        GrowStage {
-				1.0, ivec2(3, 11),
-				LoadImage("data/plant0_stage1.png"),
-			},
-	        GrowStage {
-				2.0, ivec2(3, 11),
-				LoadImage("data/plant0_stage2.png"),
-			},
-	        GrowStage {
-				3.0, ivec2(3, 11),
-				LoadImage("data/plant0_stage3.png"),
-			},
-	        GrowStage {
-				4.0, ivec2(3, 11),
-				LoadImage("data/plant0_stage4.png"),
-			},
-		}
-	};
+	SDL_SetRenderDrawColor(renderer, DARK_GREEN, 0xFF);
+	SDL_RenderClear(renderer);
 
-	plantTypes[1] = PlantType
-	{
-		"Rotbeer-Strauch",
-		0.01,
-		{
-	        GrowStage {
-				0.0, ivec2(3, 11),
-				LoadImage("data/plant1_stage0.png"),
-			},
-	        GrowStage {
-				1.0, ivec2(3, 11),
-				LoadImage("data/plant1_stage1.png"),
-			},
-	        GrowStage {
-				2.0, ivec2(3, 11),
-				LoadImage("data/plant1_stage2.png"),
-			},
-	        GrowStage {
-				3.0, ivec2(3, 11),
-				LoadImage("data/plant1_stage3.png"),
-			},
-	        GrowStage {
-				4.0, ivec2(3, 11),
-				LoadImage("data/plant1_stage4.png"),
-			},
-	        GrowStage {
-				5.0, ivec2(3, 11),
-				LoadImage("data/plant1_stage5.png"),
-			},
-	        GrowStage {
-				6.0, ivec2(3, 11),
-				LoadImage("data/plant1_stage6.png"),
-			},
-	        GrowStage {
-				7.0, ivec2(3, 11),
-				LoadImage("data/plant1_stage7.png"),
-			},
-	        GrowStage {
-				8.0, ivec2(3, 11),
-				LoadImage("data/plant1_stage8.png"),
-			},
-		}
-	};
+	SDL_SetRenderDrawColor(renderer, DARK_GRAY, 0xFF);
+	SDL_RenderFillRect(renderer, &bar);
+
+	bar.w = int(bar.w * done / total);
+	SDL_SetRenderDrawColor(renderer, WHITE, 0xFF);
+	SDL_RenderFillRect(renderer, &bar);
+
+	SDL_RenderPresent(renderer);
+}
 
-	plantTypes[2] = PlantType
+static void measure_sprites(ivec2 & lo, ivec2 & hi, std::vector<std::vector<StageBounds>> & bounds)
+{
+	lo = hi = ivec2(0, 0);
+	auto include_reach = [&](Sprite const & sprite)
 	{
-		"Citromben-Baum",
-		0.01,
-		{
-	        GrowStage {
-				0.0, ivec2(3, 11),
-				LoadImage("data/plant2_stage0.png"),
-			},
-	        GrowStage {
-				1.0, ivec2(3, 11),
-				LoadImage("data/plant2_stage1.png"),
-			},
-	        GrowStage {
-				2.0, ivec2(3, 11),
-				LoadImage("data/plant2_stage2.png"),
-			},
-	        GrowStage {
-				3.0, ivec2(3, 11),
-				LoadImage("data/plant2_stage3.png"),
-			},
-	        GrowStage {
-				4.0, ivec2(3, 11),
-				LoadImage("data/plant2_stage4.png"),
-			},
-	        GrowStage {
-				5.0, ivec2(3, 11),
-				LoadImage("data/plant2_stage5.png"),
-			},
-	        GrowStage {
-				6.0, ivec2(3, 11),
-				LoadImage("data/plant2_stage6.png"),
-			},
-	        GrowStage {
-				7.0, ivec2(3, 11),
-				LoadImage("data/plant2_stage7.png"),
-			},
-	        GrowStage {
-				8.0, ivec2(3, 11),
-				LoadImage("data/plant2_stage8.png"),
-			},
-		}
+		lo = min(lo, -sprite.origin);
+		hi = max(hi, sprite.size - sprite.origin);
 	};
-
-	plantTypes[3] = PlantType
+	include_reach(*textures.planthole);
+	bounds.resize(plantTypes.size());
+	for(size_t i = 0; i < plantTypes.size(); i++)
 	{
-		"Rankum",
-		0.0075,
+		bounds[i].clear();
+		for(auto const & stage : plantTypes[i].stages)
 		{
-	        GrowStage {
-				0.0, ivec2(5, 11),
-				LoadImage("data/plant3_stage0.png"),
-			},
-	        GrowStage {
-				1.0, ivec2(5, 11),
-				LoadImage("data/plant3_stage1.png"),
-			},
-	        GrowStage {
-				2.0, ivec2(5, 11),
-				LoadImage("data/plant3_stage2.png"),
-			},
-	        GrowStage {
-				3.0, ivec2(5, 11),
-				LoadImage("data/plant3_stage3.png"),
-			},
-	        GrowStage {
-				4.0, ivec2(5, 11),
-				LoadImage("data/plant3_stage4.png"),
-			},
-	        GrowStage {
-				5.0, ivec2(5, 11),
-				LoadImage("data/plant3_stage5.png"),
-			},
-	        GrowStage {
-				6.0, ivec2(5, 11),
-				LoadImage("data/plant3_stage6.png"),
-			},
-	        GrowStage {
-				7.0, ivec2(5, 11),
-				LoadImage("data/plant3_stage7.png"),
-			},
-	        GrowStage {
-				8.0, ivec2(5, 11),
-				LoadImage("data/plant3_stage8.png"),
-			},
+			include_reach(*stage.sprite);
+			bounds[i].push_back(StageBounds { stage.sprite->size, stage.sprite->origin });
 		}
-	};
+	}
+}
 
-	plantTypes[4] = PlantType
+void game_init(GameOptions const & options)
+{
+	savegame_file = options.save_file;
+	persistent = options.persistent;
+
+	// Made by baker/mlg-bake, without it every file is decoded
+	resources.open_pack("data/assets.pack");
+
+	textures.mouse_cursors[Hand] = resources.sprite("data/mouse_hand.png", tool_offsets[Hand]);
+	textures.mouse_cursors[Shovel] = resources.sprite("data/mouse_shovel.png", tool_offsets[Shovel]);
+	textures.mouse_cursors[WateringCan] = resources.sprite("data/mouse_watering_can.png", tool_offsets[WateringCan]);
+	textures.mouse_cursors[Pot] = resources.sprite("data/mouse_pot.png", tool_offsets[Pot]);
+	textures.mouse_cursors[Fertilizer] = resources.sprite("data/mouse_fertilizer.png", tool_offsets[Fertilizer]);
+	textures.mouse_cursors[Seeds] = resources.sprite("data/seeds.png", tool_offsets[Seeds]);
+	textures.ui_overlay = resources.sprite("data/ui_overlay.png");
+	textures.ui_catalog = resources.sprite("data/catalog.png");
+	textures.planthole = resources.sprite("data/planthole.png", ivec2(2,1));
+	textures.font = resources.sprite("data/font.png");
+	textures.coins = resources.sprite("data/coins.png");
+
+	sounds.click = resources.sound("data/click.wav");
+	sounds.dig = resources.sound("data/dig.wav");
+	sounds.splash = resources.sound("data/splash.wav");
+	sounds.spray = resources.sound("data/spray.wav");
+	sounds.exhume = resources.sound("data/exhume.wav");
+	sounds.plant = resources.sound("data/plant.wav");
+	sounds.nope = resources.sound("data/nope.wav");
+
+	plantTypes = LoadCatalog("data/plants.cat");
+	for(auto & type : plantTypes)
 	{
-		"Zennie",
-		0.012,
-		{
-	        GrowStage {
-				0.0, ivec2(5, 11),
-				LoadImage("data/plant4_stage0.png"),
-			},
-	        GrowStage {
-				1.0, ivec2(5, 11),
-				LoadImage("data/plant4_stage1.png"),
-			},
-	        GrowStage {
-				2.0, ivec2(5, 11),
-				LoadImage("data/plant4_stage2.png"),
-			},
-	        GrowStage {
-				3.0, ivec2(5, 11),
-				LoadImage("data/plant4_stage3.png"),
-			},
-	        GrowStage {
-				4.0, ivec2(5, 11),
-				LoadImage("data/plant4_stage4.png"),
-			},
-	        GrowStage {
-				5.0, ivec2(5, 11),
-				LoadImage("data/plant4_stage5.png"),
-			},
-	        GrowStage {
-				6.0, ivec2(5, 11),
-				LoadImage("data/plant4_stage6.png"),
-			},
-		}
-	};
+		for(auto & stage : type.stages)
+			stage.sprite = resources.sprite(stage.image.c_str(), stage.origin);
+	}
+
+	resources.load(render_loading);
+	text.reset(new TextRenderer(textures.font, ivec2(4, 5), "0123456789"));
+	if(options.hot_reload)
+		resources.watch("data");
+
+	// UI feedback wins over garden noise, which is spammed easily
+	ConfigureSound(*sounds.click, 3, 1);
+	ConfigureSound(*sounds.nope, 3, 1);
+	ConfigureSound(*sounds.plant, 2, 2);
+	ConfigureSound(*sounds.exhume, 2, 2);
+	ConfigureSound(*sounds.dig, 1, 2);
+	ConfigureSound(*sounds.splash, 0, 2);
+	ConfigureSound(*sounds.spray, 0, 2);
+
+	measure_sprites(sprite_reach_min, sprite_reach_max, stage_bounds);
 
-	PlayMusic(LoadMusic("data/truth_in_the_stones.mp3"));
+	music = resources.music("data/truth_in_the_stones.mp3");
+	PlayMusic(*music);
 
 	if(game_has_save())
 		game_load();
 	else
-		plants.clear();
+		garden.clear();
+
+	autosave.reset(new Autosave(savegame_file.c_str()));
+	jobs.reset(new JobSystem());
+	autosave_timer = autosave_interval;
+
+	game_publish();
 }
 
 void game_shutdown()
 {
-	game_save();
+	jobs.reset();
+	autosave->finish();
+	autosave.reset();
+	if(persistent)
+		game_save();
+
+	// Dropping the last handles frees the assets
+	resources.unwatch();
+	text.reset();
+	textures = decltype(textures)();
+	sounds = decltype(sounds)();
+	music.reset();
+	plantTypes.clear();
+	stage_bounds.clear();
+	reloaded_stage_bounds.clear();
+	resources.collect();
 }
 
 void game_update()
 {
-	std::sort(
-		plants.begin(), plants.end(),
-		[](Plant const & l, Plant const & r)
-		{
-			return l.position.y < r.position.y;
-		});
-	// Update all plants
-	for(auto & plant : plants)
+	autosave->barrier();
+
+	// A reloaded sprite may have changed size, which moves the
+	// culling bounds and dirty rects of every plant
+	if(reach_reloaded.exchange(false))
 	{
-		if(plant._type < 0)
-			continue;
-		auto delta = min(plant.watering, plant.type().growspeed);
-		if(delta > 0)
-		{
-			plant.growth += delta;
-			plant.watering -= delta;
-		}
+		std::lock_guard<std::mutex> _l(reloaded_reach_mutex);
+		sprite_reach_min = reloaded_reach_min;
+		sprite_reach_max = reloaded_reach_max;
+		stage_bounds.swap(reloaded_stage_bounds);
+		mark_all_dirty();
 	}
 
-	for(auto & part : particles)
+	// Only plants that reach a new stage are touched
+	stage_changes.clear();
+	garden.advance(stage_changes);
+	for(auto const & pos : stage_changes)
+		mark_dirty(pos);
+
+	jobs->parallel_for(particles.size(), 16384, [](size_t begin, size_t end)
 	{
-		part.lifespan -= 1;
-		part.pos += part.vel;
-		part.vel += part.accel;
-	}
-	particles.erase(
-		std::remove_if(
-			particles.begin(),
-			particles.end(),
-			[](Particle const & p) { return p.lifespan <= 0; }),
-		particles.end());
+		particles.integrate(begin, end);
+	});
+	particles.remove_dead();
+
+	if(persistent && --autosave_timer <= 0 && autosave->begin(player_money, garden))
+		autosave_timer = autosave_interval;
 }
 
 void tool_click(int id)
@@ -456,27 +516,27 @@ void tool_click(int id)
 	tool = Tool(id);
 	gamestate = GardenView;
 
-	PlaySound(sounds.click);
+	PlaySound(*sounds.click);
 }
 
 // 4 pixels distance
 static float mouse_sensitivity = 4.0;
 
-static auto get_clicked(ivec2 pos)
+static Garden::Ref get_clicked(ivec2 pos)
 {
-	auto nearest = plants.end();
-	float dist = std::numeric_limits<decltype(dist)>::max();
-	for(auto it = plants.begin(); it != plants.end(); it++)
-	{
-		auto d = distance(vec2(pos), vec2(it->position));
-		if(d > dist)
-			continue;
-		if(d > mouse_sensitivity)
-			continue;
-		nearest = it;
-		dist = d;
-	}
-	return nearest;
+	return garden.nearest(pos, mouse_sensitivity);
+}
+
+static void add_plant(Plant const & plant)
+{
+	mark_dirty(plant.position);
+	garden.add(plant);
+}
+
+static void remove_plant(Garden::Ref ref)
+{
+	mark_dirty(garden.get(ref).position);
+	garden.remove(ref);
 }
 
 void hand_click(ivec2)
@@ -486,13 +546,12 @@ void hand_click(ivec2)
 
 void shovel_click(ivec2 pos)
 {
-	auto clicked = get_clicked(pos);
-	if(clicked != plants.end())
+	if(get_clicked(pos))
 		return;
 
-	PlaySound(sounds.dig);
+	PlaySound(*sounds.dig);
 
-	emit(5, [&](Particle & p)
+	particles.emit(5, [&](Particle & p)
 	{
 		p.pos = pos;
 		p.vel = vec2(rng(-0.25, 0.25), rng(-0.5, -0.3));
@@ -501,12 +560,12 @@ void shovel_click(ivec2 pos)
 		p.lifespan = 30 + rng(0, 30);
 	});
 
-	plants.push_back(Plant { -1, pos, 0.0, 0.0 });
+	add_plant(Plant { -1, pos, 0.0, 0.0 });
 }
 
 void watering_can_click(ivec2 pos)
 {
-	emit(10, [&](Particle & p)
+	particles.emit(10, [&](Particle & p)
 	{
 		p.pos = pos;
 		p.vel = vec2(rng(-0.2, -0.01), rng(-0.1, 0.3));
@@ -514,72 +573,83 @@ void watering_can_click(ivec2 pos)
 		p.lifespan = 20 + rng(0, 30);
 	});
 
-	PlaySound(sounds.splash);
+	PlaySound(*sounds.splash);
 
 	auto clicked = get_clicked(pos);
-	if(clicked == plants.end())
+	if(!clicked)
 		return;
-	if(clicked->_type == -1)
+	auto plant = garden.get(clicked);
+	if(plant._type == -1)
 		return;
-	clicked->watering += rng(1.78, 2.44);
+	plant.watering += rng(1.78, 2.44);
+	garden.set(clicked, plant);
 }
 
 void pot_click(ivec2 pos)
 {
 	auto clicked = get_clicked(pos);
-	if(clicked == plants.end())
+	if(!clicked)
 		return;
-	if(clicked->_type == -1)
+	auto const plant = garden.get(clicked);
+	if(plant._type == -1)
 		return;
-	auto const & type = clicked->type();
-	if(clicked->growth < type.stages.back().growth)
+	auto const & type = plant.type();
+	if(plant.growth < type.stages.back().growth)
 		return;
 
-	auto const & stage = type.stages.back();
-
- 	ivec2 size = GetSize(stage.graphics);
+	auto const & bounds = stage_bounds[size_t(plant._type)].back();
+	auto const size = bounds.size;
 
-	emit(max(1, int(0.1 * size.x * size.y)), [&](Particle & p)
+	particles.emit(max(1, int(0.1 * size.x * size.y)), [&](Particle & p)
 	{
-		p.pos = vec2(clicked->position - stage.origin) + vec2(rng(0.0f,float(size.x)), rng(0.0f,float(size.y)        ));
+		p.pos = vec2(plant.position - bounds.origin) + vec2(rng(0.0f,float(size.x)), rng(0.0f,float(size.y)        ));
 		p.vel = 0.1f * normalize(vec2(rng(-1.0, 1.0), rng(0.0, 1.0)));
 		p.color = Color { GREEN };
 		p.lifespan = rng(40, 90);
 	});
 
-	player_money += sellprice[clicked->_type];
-	plants.erase(clicked);
-	PlaySound(sounds.exhume);
+	player_money += type.sellprice;
+	remove_plant(clicked);
+	PlaySound(*sounds.exhume);
 }
 
 void fertilizer_click(ivec2 pos)
 {
-	emit(7, [&](Particle & p)
+	particles.emit(7, [&](Particle & p)
 	{
 		p.pos = pos;
 		p.vel = 0.3f * normalize(vec2(-1.0, rng(-0.5, 1.0)));
 		p.color = Color { INDIGO };
 		p.lifespan = 20;
 	});
-	PlaySound(sounds.spray);
+	PlaySound(*sounds.spray);
 }
 
 void seeds_click(ivec2 pos)
 {
 	auto clicked = get_clicked(pos);
-	if(clicked == plants.end())
+	if(!clicked)
 		return;
-	if(clicked->_type != -1)
+	auto plant = garden.get(clicked);
+	if(plant._type != -1)
 		return;
-	player_money -= buyprice[seedtype];
-	clicked->_type = int(seedtype);
+	player_money -= plantTypes[seedtype].buyprice;
+	plant._type = int(seedtype);
+	garden.set(clicked, plant);
+	mark_dirty(plant.position);
 	tool = Hand;
-	PlaySound(sounds.plant);
+	PlaySound(*sounds.plant);
+}
+
+// The catalog page has room for five plants
+static unsigned int catalog_size()
+{
+	return std::min(5u, unsigned(plantTypes.size()));
 }
 
 void catalog_click()
 {
-	PlaySound(sounds.click);
+	PlaySound(*sounds.click);
 	if(gamestate == CatalogView)
 		gamestate = GardenView;
 	else
@@ -622,11 +692,15 @@ void game_do_event(SDL_Event const & ev)
 					break;
 				catalog_click();
 			}
-			else if(mouse_pos.x >= 10 && mouse_pos.x < 79 && mouse_pos.y < 59)
+			else if(contains(viewport, mouse_pos))
 			{
 				if(gamestate == GardenView)
 				{
-					auto pos = mouse_pos - ivec2(10, 0) + scroll_offset;
+					// Only tool clicks modify the garden, so only they wait
+					// for a running autosave to finish its snapshot
+					autosave->barrier();
+
+					auto pos = mouse_pos - ivec2(viewport.x, viewport.y) + scroll_offset;
 					switch(tool)
 					{
 					case Hand: hand_click(pos); break;
@@ -639,20 +713,20 @@ void game_do_event(SDL_Event const & ev)
 				}
 				else if(gamestate == CatalogView)
 				{
-					for(unsigned int i = 0; i < plantTypes.size(); i++)
+					for(unsigned int i = 0; i < catalog_size(); i++)
 					{
 						if(!contains(SDL_Rect { 11, int(10 * i + 8), 9, 9 }, mouse_pos))
 							continue;
-						if(buyprice[i] <= player_money)
+						if(plantTypes[i].buyprice <= player_money)
 						{
 							seedtype = i;
 							tool = Seeds;
 							gamestate = GardenView;
-							PlaySound(sounds.click);
+							PlaySound(*sounds.click);
 						}
 						else
 						{
-							PlaySound(sounds.nope);
+							PlaySound(*sounds.nope);
 						}
 						break;
 					}
@@ -667,10 +741,7 @@ void game_do_event(SDL_Event const & ev)
 			auto delta = mouse_pos - prev;
 			if(is_scrolling)
 			{
-				scroll_offset = clamp(
-					scroll_offset - delta,
-					ivec2(0,0),
-					ivec2(65, 55));
+				scroll_offset -= delta;
 			}
 			break;
 		}
@@ -679,99 +750,401 @@ void game_do_event(SDL_Event const & ev)
 			is_scrolling = false;
 			break;
 		}
+		case SDL_RENDER_TARGETS_RESET:
+		case SDL_RENDER_DEVICE_RESET:
+		{
+			mark_all_dirty();
+			break;
+		}
 	}
 }
 
-static void draw_plant(Plant const & plant)
+static Sprite const & plant_sprite(Garden::Chunk const & chunk, uint32_t id)
+{
+	auto const type = chunk.type[id];
+	if(type < 0)
+		return *textures.planthole;
+
+	// The stage index is cached by the garden, no lookup by growth
+	return *plantTypes[size_t(type)].stages[chunk.stage[id]].sprite;
+}
+
+// Collects the sprites reaching into chunk coord, back to front
+static void list_plants(ivec2 coord, std::vector<PlantSprite> & plants)
+{
+	auto const origin = coord * Garden::chunk_size;
+	plants.clear();
+	garden.for_each_in(
+		origin.x - sprite_reach_max.x + 1, origin.x + Garden::chunk_size - sprite_reach_min.x,
+		origin.y - sprite_reach_max.y + 1, origin.y + Garden::chunk_size - sprite_reach_min.y,
+		[&](Garden::Chunk const & chunk, uint32_t id)
+		{
+			plants.push_back(PlantSprite { &plant_sprite(chunk, id), chunk.position[id] });
+		});
+}
+
+// Redraws rect (in garden coordinates) into the image of chunk coord
+// Uses the layers layer and layer + 1 of the current target
+static void redraw_chunk(ChunkView const & view, SDL_Rect rect, int layer)
 {
-	if(plant._type < 0)
+	auto const origin = view.coord * Garden::chunk_size;
+
+	SDL_Rect clip { rect.x - origin.x, rect.y - origin.y, rect.w, rect.h };
+	renderQueue.set_clip(&clip);
+
+	renderQueue.set_layer(layer);
+	renderQueue.fill_rect(clip, SDL_Color { DARK_GREEN, 0xFF });
+
+	renderQueue.set_layer(layer + 1);
+	SpriteBatch batch;
+	for(auto const & plant : view.plants)
 	{
-		BlitImage(
-			textures.planthole,
-			plant.position - ivec2(2,1));
-		return;
+		auto const lo = plant.position - plant.sprite->origin;
+		auto const hi = lo + plant.sprite->size;
+		if(hi.x <= rect.x || hi.y <= rect.y || lo.x >= rect.x + rect.w || lo.y >= rect.y + rect.h)
+			continue;
+		batch.add(*plant.sprite, plant.position - origin);
 	}
+	batch.flush();
+
+	renderQueue.set_clip(nullptr);
+}
 
-	GrowStage const * stage = &plant.type().stages[0];
-	for(auto const & st : plant.type().stages)
+static ChunkImage & get_chunk_image(ivec2 coord)
+{
+	auto const key = Garden::key_of(coord);
+	auto it = chunk_images.find(key);
+	if(it != chunk_images.end())
+		return it->second;
+
+	// Recycle the least recently used image that is not on screen
+	Image texture = nullptr;
+	if(chunk_images.size() >= max_chunk_images)
 	{
-		if(plant.growth >= st.growth)
-			stage = &st;
+		auto lru = chunk_images.end();
+		for(auto i = chunk_images.begin(); i != chunk_images.end(); i++)
+		{
+			if(i->second.last_used == frame_counter)
+				continue;
+			if(lru == chunk_images.end() || i->second.last_used < lru->second.last_used)
+				lru = i;
+		}
+		if(lru != chunk_images.end())
+		{
+			texture = lru->second.texture;
+			chunk_images.erase(lru);
+		}
 	}
-	BlitImage(
-		stage->graphics,
-		plant.position - stage->origin);
+	if(texture == nullptr)
+		texture = CreateRenderTarget(Garden::chunk_size, Garden::chunk_size);
+
+	return chunk_images[key] = ChunkImage { texture, false, 0, frame_counter };
 }
 
-static void render_acre()
+static void invalidate_chunk_images()
 {
-	RenderTargetGuard _g(acreTarget);
+	for(auto & it : chunk_images)
+		it.second.valid = false;
+}
 
-	SDL_SetRenderDrawColor(renderer, DARK_GREEN, 0xFF);
-	SDL_RenderClear(renderer);
+template<typename F>
+static void for_each_visible_chunk(F && fn)
+{
+	auto const lo = Garden::chunk_of(scroll_offset);
+	auto const hi = Garden::chunk_of(scroll_offset + ivec2(viewport.w - 1, viewport.h - 1));
+	for(int y = lo.y; y <= hi.y; y++)
+	{
+		for(int x = lo.x; x <= hi.x; x++)
+			fn(ivec2(x, y));
+	}
+}
 
-	for(auto const & plant : plants)
-		draw_plant(plant);
+static void render_acre(Snapshot const & snapshot)
+{
+	PROFILE_SCOPE("render_acre");
 
-	for(auto const & p : particles)
+	frame_counter++;
+	for(auto const & view : snapshot.chunks)
 	{
-		SDL_SetRenderDrawColor(renderer, p.color.r, p.color.g, p.color.b, 0xFF);
-		SDL_RenderDrawPoint(renderer, int(p.pos.x + 0.5f), int(p.pos.y + 0.5f));
+		auto & image = get_chunk_image(view.coord);
+		image.last_used = frame_counter;
+		auto const version = std::max(view.version, snapshot.all_dirty);
+		if(image.valid && image.version >= version)
+			continue;
+
+		QueueTargetGuard _g(image.texture);
+
+		// Snapshots may be skipped, so every change since the
+		// version of the image has to be redrawn.
+		if(!image.valid || image.version < std::max(view.base, snapshot.all_dirty))
+		{
+			auto const origin = view.coord * Garden::chunk_size;
+			redraw_chunk(view, SDL_Rect { origin.x, origin.y, Garden::chunk_size, Garden::chunk_size }, 0);
+		}
+		else
+		{
+			// Later rects overdraw earlier ones, so each needs its own layers
+			int layer = 0;
+			for(auto const & dirty : view.dirty)
+			{
+				if(dirty.version <= image.version)
+					continue;
+				redraw_chunk(view, dirty.rect, layer);
+				layer += 2;
+			}
+		}
+		image.valid = true;
+		image.version = version;
 	}
 }
 
 // pos.x is right aligned
 static void render_num(ivec2 pos, bool active, int number)
 {
-	int const y = active ? 5 : 0;
-	BlitImagePortion(textures.coins,pos,SDL_Rect { 0, y, 5, 5 });
-	pos.x -= 4;
-	if(number == 0)
+	BlitSpritePortion(*textures.coins,pos,SDL_Rect { 0, active ? 5 : 0, 5, 5 });
+	auto const digits = std::to_string(number);
+	text->draw(ivec2(pos.x - text->width(digits), pos.y), digits, active ? 1 : 0);
+}
+
+// Frame phases in microseconds, two columns of colored rows, and a graph
+// of the recent frame times, one pixel per millisecond.
+static void render_profiler()
+{
+	static Color const phase_colors[] =
+	{
+		Color { RED }, Color { ORANGE }, Color { YELLOW }, Color { GREEN },
+		Color { BLUE }, Color { INDIGO }, Color { PINK }, Color { PEACH },
+	};
+	size_t const num_colors = sizeof phase_colors / sizeof phase_colors[0];
+
+	renderQueue.set_layer(LayerProfiler);
+	renderQueue.fill_rect(viewport, SDL_Color { BLACK, 0xC0 }, SDL_BLENDMODE_BLEND);
+
+	// The numbers change every frame, caching them would not pay off
+	SpriteBatch numbers;
+	ProfilePhase phases[num_colors];
+	size_t const count = ProfileLastFrame(phases, num_colors);
+	for(size_t i = 0; i < count; i++)
 	{
-		BlitImagePortion(textures.font,pos,SDL_Rect { 0, y, 4, 5 });
+		auto const pos = ivec2(11 + 34 * int(i % 2), 1 + 6 * int(i / 2));
+		auto const & color = phase_colors[i];
+		SDL_Rect const swatch { pos.x, pos.y, 3, 5 };
+		renderQueue.fill_rect(swatch, SDL_Color { color.r, color.g, color.b, 0xFF });
+		auto const us = std::to_string(min(99999, int(1000.0 * phases[i].ms)));
+		text->add(numbers, pos + ivec2(24 - text->width(us), 0), us, 1);
 	}
-	else
+
+	int const width = 64;
+	int const bottom = viewport.y + viewport.h - 1;
+	float times[width];
+	ProfileFrameTimes(times, width);
+
+	// 60 frames per second budget
+	renderQueue.line(ivec2(viewport.x + 1, bottom - 17), ivec2(viewport.x + width, bottom - 17), SDL_Color { DARK_GRAY, 0xFF });
+	for(int i = 0; i < width; i++)
+	{
+		if(times[i] <= 0.0f)
+			continue;
+		int const height = min(32, int(times[i] + 0.5f));
+		SDL_Color const color = (times[i] > 1000.0f / 60.0f + 0.5f) ? SDL_Color { RED, 0xFF } : SDL_Color { WHITE, 0xFF };
+		renderQueue.line(ivec2(viewport.x + 1 + i, bottom), ivec2(viewport.x + 1 + i, bottom - height + 1), color);
+	}
+
+	// Draw calls and state switches of the last submitted frame
+	auto const & stats = renderQueue.stats();
+	auto const calls = std::to_string(stats.drawCalls);
+	auto const switches = std::to_string(stats.targetSwitches + stats.textureSwitches + stats.clipSwitches);
+	text->add(numbers, ivec2(viewport.x + 1, bottom - 32), calls, 1);
+	text->add(numbers, ivec2(viewport.x + viewport.w - 1 - text->width(switches), bottom - 32), switches, 0);
+	renderQueue.set_layer(LayerProfilerText);
+	numbers.flush();
+}
+
+static void render_ui(Snapshot const & snapshot, float alpha)
+{
+	PROFILE_SCOPE("render_ui");
+
+	renderQueue.set_layer(LayerBackground);
+	renderQueue.clear(SDL_Color { RED, 0xFF });
+
+	if(snapshot.gamestate == GardenView)
+	{
+		auto const offset = ivec2(viewport.x, viewport.y) - snapshot.scroll_offset;
+
+		renderQueue.set_clip(&viewport);
+		renderQueue.set_layer(LayerGarden);
+		for(auto const & view : snapshot.chunks)
+			BlitImage(get_chunk_image(view.coord).texture, offset + view.coord * Garden::chunk_size);
+		renderQueue.set_layer(LayerParticles);
+		snapshot.particles.draw(offset, alpha);
+		renderQueue.set_clip(nullptr);
+	}
+
+	renderQueue.set_layer(LayerOverlay);
+	BlitSprite(*textures.ui_overlay, ivec2());
+
+	// The garden has no borders, so the scroll bars wrap around
+	auto const bar = ivec2(
+		(snapshot.scroll_offset.x % 66 + 66) % 66,
+		(snapshot.scroll_offset.y % 56 + 56) % 56);
+	renderQueue.set_layer(LayerScrollBars);
+	renderQueue.line(ivec2(10 + bar.x, 59), ivec2(13 + bar.x, 59), SDL_Color { WHITE, 0xFF });
+	renderQueue.line(ivec2(79, bar.y), ivec2(79, bar.y + 3), SDL_Color { WHITE, 0xFF });
+
+	if(snapshot.gamestate == CatalogView)
 	{
-		while(number > 0)
+		renderQueue.set_layer(LayerCatalog);
+		BlitSprite(*textures.ui_catalog, ivec2());
+
+		renderQueue.set_layer(LayerCatalogText);
+		render_num(ivec2(74, 1), true, snapshot.money);
+		for(unsigned int i = 0; i < catalog_size(); i++)
 		{
-			BlitImagePortion(textures.font,pos,SDL_Rect { 4*(number%10), y, 4, 5 });
-			number /= 10;
-			pos.x -= 4;
+			auto const price = plantTypes[i].buyprice;
+			render_num(ivec2(74, 11 + 10*i), snapshot.money >= price, price);
 		}
 	}
+
+	if(show_profiler)
+		render_profiler();
+
+	renderQueue.set_layer(LayerCursor);
+	BlitSprite(
+		*textures.mouse_cursors[int(snapshot.tool)],
+		snapshot.mouse_pos);
 }
 
-static void render_ui()
+void game_render(float alpha)
 {
-	SDL_SetRenderDrawColor(renderer, RED, 0xFF);
-	SDL_RenderClear(renderer);
+	// Cached chunk images still show the old sprites
+	if(resources.apply_reloads())
+	{
+		invalidate_chunk_images();
+		text->clear();
 
-	if(gamestate == GardenView)
-		BlitImage(acreTarget, ivec2(10, 0) - scroll_offset);
+		std::lock_guard<std::mutex> _l(reloaded_reach_mutex);
+		measure_sprites(reloaded_reach_min, reloaded_reach_max, reloaded_stage_bounds);
+		reach_reloaded = true;
+	}
 
-	BlitImage(textures.ui_overlay, ivec2());
+	snapshots.update();
+	auto const & snapshot = snapshots.front();
 
-	SDL_SetRenderDrawColor(renderer, WHITE, 0xFF);
-	SDL_RenderDrawLine(renderer, 10 + scroll_offset.x, 59, 13 + scroll_offset.x, 59);
-	SDL_RenderDrawLine(renderer, 79, scroll_offset.y, 79, scroll_offset.y + 3);
+	// all_dirty also changes when render targets lost their contents,
+	// the cached strings are render targets too
+	static uint64_t text_version = 0;
+	if(snapshot.all_dirty != text_version)
+	{
+		text->clear();
+		text_version = snapshot.all_dirty;
+	}
 
-	if(gamestate == CatalogView)
+	if(snapshot.gamestate == GardenView)
+		render_acre(snapshot);
+	render_ui(snapshot, alpha);
+}
+
+void game_toggle_profiler()
+{
+	show_profiler = !show_profiler;
+}
+
+void game_publish()
+{
+	PROFILE_SCOPE("game_publish");
+
+	auto & snapshot = snapshots.back();
+	snapshot.gamestate = gamestate;
+	snapshot.tool = tool;
+	snapshot.money = player_money;
+	snapshot.scroll_offset = scroll_offset;
+	snapshot.mouse_pos = mouse_pos;
+	snapshot.all_dirty = all_dirty_version;
+
+	// Views are overwritten in place, so their memory is reused
+	size_t count = 0;
+	for_each_visible_chunk([&](ivec2 coord)
 	{
-		BlitImage(textures.ui_catalog, ivec2());
+		if(count == snapshot.chunks.size())
+			snapshot.chunks.emplace_back();
+		auto & view = snapshot.chunks[count++];
+
+		auto & log = chunk_logs[Garden::key_of(coord)];
+		auto const current = std::max(log.version, all_dirty_version);
+		if(log.listed != current)
+		{
+			list_plants(coord, log.plants);
+			log.listed = current;
+		}
+
+		// Unchanged chunks cost nothing to publish
+		if(view.coord != coord || view.listed != log.listed)
+		{
+			view.dirty = log.dirty;
+			view.plants = log.plants;
+			view.listed = log.listed;
+		}
+		view.coord = coord;
+		view.version = log.version;
+		view.base = log.base;
+	});
+	snapshot.chunks.resize(count);
+
+	particles.snapshot(snapshot.particles);
+	snapshots.publish();
+}
 
-		render_num(ivec2(74, 1), true, player_money);
-		for(int i = 0; i < 5; i++)
-			render_num(ivec2(74, 11 + 10*i), player_money >= buyprice[i], buyprice[i]);
+size_t game_plant_type_count()
+{
+	return plantTypes.size();
+}
+
+void game_populate(size_t count, uint32_t seed)
+{
+	autosave->barrier();
+	rng_seed(seed);
+
+	// Roughly as dense as a well kept garden, one plant per 4x4 pixels
+	int const side = max(1, int(std::sqrt(16.0 * double(count))));
+
+	std::vector<Plant> plants(count);
+	for(auto & plant : plants)
+	{
+		plant._type = rng(-1, int(plantTypes.size()));
+		plant.position = ivec2(rng(0, side), rng(0, side));
+		plant.growth = 0.0;
+		plant.watering = rng(0.0, 100.0);
+		if(plant._type >= 0)
+			plant.growth = rng(0.0, plant.type().stages.back().growth);
 	}
+	garden.assign(plants);
+	particles.clear();
+	scroll_offset = ivec2();
+	mark_all_dirty();
+}
 
-	BlitImage(
-		textures.mouse_cursors[int(tool)],
-		mouse_pos - tool_offsets[int(tool)]);
+bool game_pick(ivec2 pos)
+{
+	return bool(get_clicked(pos));
 }
 
-void game_render()
+void game_redraw_garden()
 {
-	if(gamestate == GardenView)
-		render_acre();
-	render_ui();
+	static Image scratch = CreateRenderTarget(Garden::chunk_size, Garden::chunk_size);
+
+	static ChunkView view;
+
+	{
+		QueueTargetGuard _g(scratch);
+		int layer = 0;
+		garden.for_each_chunk([&](Garden::Chunk & chunk)
+		{
+			auto const origin = chunk.coord * Garden::chunk_size;
+			view.coord = chunk.coord;
+			list_plants(chunk.coord, view.plants);
+			redraw_chunk(view, SDL_Rect { origin.x, origin.y, Garden::chunk_size, Garden::chunk_size }, layer);
+			layer += 2;
+		});
+	}
+	renderQueue.submit();
 }
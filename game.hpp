@@ -3,14 +3,61 @@
 
 #include "engine.h"
 
-void game_init();
+#include <cstdint>
+
+struct GameOptions
+{
+	// Savegame that is loaded at startup
+	char const * save_file = "savegame.dat";
+
+	// Autosave while running and save again on shutdown
+	bool persistent = true;
+
+	// Reload images and sounds in data/ when they change on disk
+	bool hot_reload = true;
+};
+
+// game_init(), game_update(), game_do_event() and game_publish() belong
+// to the simulation thread, game_render() to the render thread. Both may
+// be the same thread.
+
+void game_init(GameOptions const & options);
 
 void game_update();
 
-void game_render();
+// Hands the current state over to game_render()
+void game_publish();
+
+// Draws the state of the latest game_publish(). alpha is the time since
+// then in ticks, 0 to 1
+void game_render(float alpha);
 
 void game_shutdown();
 
 void game_do_event(SDL_Event const & ev);
 
+// Shows or hides the profiler overlay, belongs to the render thread
+void game_toggle_profiler();
+
+void game_save_as(char const * fileName);
+
+void game_load_from(char const * fileName);
+
+// Hash over the whole simulation state, equal for identical sessions
+uint64_t game_state_hash();
+
+// Hooks for the benchmarks in bench/, they bypass the input handling.
+
+// Number of plant types in data/plants.cat
+size_t game_plant_type_count();
+
+// Replaces the garden with count random plants
+void game_populate(size_t count, uint32_t seed);
+
+// The plant lookup behind every click, true if a plant was hit
+bool game_pick(glm::ivec2 pos);
+
+// Draws every chunk of the garden once
+void game_redraw_garden();
+
 #endif // GAME_HPP
@@ -0,0 +1,257 @@
+#include "garden.hpp"
+#include "growthkernel.hpp"
+
+#include <cmath>
+
+int const Garden::chunk_size;
+
+// Wake-ups further away are split, the plant simply goes back to sleep
+static uint32_t const max_sleep = 1u << 30;
+
+static uint8_t stage_of(int type, float growth)
+{
+	if(type < 0)
+		return 0;
+	return uint8_t(Plant { type, glm::ivec2(), 0.0, 0.0 }.type().stage_index(double(growth)));
+}
+
+Plant Garden::Chunk::plant(uint32_t id, uint32_t now) const
+{
+	float g, w;
+	GrowPlant(growth[id], watering[id], growspeed[id], since[id], now, g, w);
+	return Plant { type[id], position[id], double(g), double(w) };
+}
+
+void Garden::Chunk::resize(size_t count)
+{
+	type.resize(count);
+	position.resize(count);
+	stage.resize(count);
+	growth.resize(count);
+	watering.resize(count);
+	growspeed.resize(count);
+	since.resize(count);
+	due.resize(count);
+}
+
+void Garden::Chunk::swap_remove(uint32_t id)
+{
+	auto const last = type.size() - 1;
+	type[id] = type[last];
+	position[id] = position[last];
+	stage[id] = stage[last];
+	growth[id] = growth[last];
+	watering[id] = watering[last];
+	growspeed[id] = growspeed[last];
+	since[id] = since[last];
+	due[id] = due[last];
+	resize(last);
+}
+
+Garden::Garden() : chunks(), count(0), wheel()
+{
+}
+
+Garden::Chunk * Garden::find_chunk(glm::ivec2 coord) const
+{
+	auto it = chunks.find(key_of(coord));
+	if(it == chunks.end())
+		return nullptr;
+	return it->second.get();
+}
+
+void Garden::rebase(Chunk & chunk, uint32_t id)
+{
+	GrowPlant(
+		chunk.growth[id], chunk.watering[id], chunk.growspeed[id], chunk.since[id], now(),
+		chunk.growth[id], chunk.watering[id]);
+	chunk.since[id] = now();
+}
+
+void Garden::schedule(Chunk & chunk, uint32_t id)
+{
+	// Due now means not scheduled, wake-ups only fire on later ticks
+	chunk.due[id] = now();
+
+	auto const typeId = chunk.type[id];
+	float const g = chunk.growth[id];
+	float const w = chunk.watering[id];
+	float const gs = chunk.growspeed[id];
+	if(typeId < 0 || !(gs > 0.0f))
+		return;
+
+	auto const & type = Plant { typeId, glm::ivec2(), 0.0, 0.0 }.type();
+	size_t const next = size_t(chunk.stage[id]) + 1;
+	if(next >= type.stages.size())
+		return;
+
+	// Round up, reaching the float threshold must mean reaching the stage
+	auto const threshold = type.stages[next].growth;
+	auto target = float(threshold);
+	if(double(target) < threshold)
+		target = std::nextafter(target, INFINITY);
+	if(!(g + w >= target))
+		return;
+
+	// Estimate the ticks until then, and correct the estimate with the
+	// exact float arithmetic GrowPlant() uses
+	auto const reached = [&](uint32_t ticks)
+	{
+		float go, wo;
+		GrowPlant(g, w, gs, 0, ticks, go, wo);
+		return go >= target;
+	};
+	double const estimate = std::ceil(double(target - g) / double(gs));
+	uint32_t ticks = uint32_t(std::max(1.0, std::min(estimate, double(max_sleep))));
+	while(ticks > 1 && reached(ticks - 1))
+		ticks--;
+	while(ticks < max_sleep && !reached(ticks))
+		ticks++;
+
+	chunk.due[id] = now() + ticks;
+	wheel.schedule(chunk.due[id], Wake { key_of(chunk.coord), id });
+}
+
+void Garden::advance(std::vector<glm::ivec2> & changed)
+{
+	wheel.advance([&](Wake const & wake)
+	{
+		// Plants that were modified or moved since leave stale entries
+		auto it = chunks.find(wake.chunk);
+		if(it == chunks.end())
+			return;
+		auto & chunk = *it->second;
+		auto const id = wake.id;
+		if(id >= chunk.size() || chunk.due[id] != now())
+			return;
+
+		rebase(chunk, id);
+		auto const stage = stage_of(chunk.type[id], chunk.growth[id]);
+		if(stage != chunk.stage[id])
+		{
+			chunk.stage[id] = stage;
+			changed.push_back(chunk.position[id]);
+		}
+		schedule(chunk, id);
+	});
+}
+
+Garden::Ref Garden::nearest(glm::ivec2 pos, float radius) const
+{
+	int const r = int(radius) + 1;
+	auto const lo = chunk_of(pos - glm::ivec2(r, r));
+	auto const hi = chunk_of(pos + glm::ivec2(r, r));
+
+	Ref result { nullptr, 0 };
+	float dist = radius;
+	for(int y = lo.y; y <= hi.y; y++)
+	{
+		for(int x = lo.x; x <= hi.x; x++)
+		{
+			auto * chunk = find_chunk(glm::ivec2(x, y));
+			if(chunk == nullptr)
+				continue;
+			float d;
+			auto id = chunk->grid.nearest(pos, dist, &d);
+			if(id == SpatialGrid::npos)
+				continue;
+			result = Ref { chunk, id };
+			dist = d;
+		}
+	}
+	return result;
+}
+
+void Garden::set(Ref ref, Plant const & plant)
+{
+	auto & chunk = *ref.chunk;
+	auto const id = ref.id;
+	chunk.type[id] = plant._type;
+	chunk.growth[id] = float(plant.growth);
+	chunk.watering[id] = float(plant.watering);
+	chunk.growspeed[id] = (plant._type >= 0) ? float(plant.type().growspeed) : 0.0f;
+	chunk.since[id] = now();
+	chunk.stage[id] = stage_of(plant._type, chunk.growth[id]);
+	schedule(chunk, id);
+}
+
+void Garden::add(Plant const & plant)
+{
+	auto const coord = chunk_of(plant.position);
+	auto & slot = chunks[key_of(coord)];
+	if(!slot)
+	{
+		slot.reset(new Chunk());
+		slot->coord = coord;
+	}
+
+	auto & chunk = *slot;
+	auto const id = uint32_t(chunk.size());
+	chunk.grid.insert(id, plant.position);
+	chunk.depth.insert(id, plant.position.x, plant.position.y);
+	chunk.resize(id + 1);
+	chunk.position[id] = plant.position;
+	set(Ref { &chunk, id }, plant);
+	count++;
+}
+
+void Garden::remove(Ref ref)
+{
+	auto * chunk = ref.chunk;
+	auto const id = ref.id;
+	auto const last = uint32_t(chunk->size() - 1);
+	auto const pos = chunk->position[id];
+	auto const lastPos = chunk->position[last];
+
+	chunk->grid.remove(id, pos);
+	chunk->depth.remove(id, pos.y);
+	if(id != last)
+	{
+		chunk->grid.renumber(last, id, lastPos);
+		chunk->depth.renumber(last, id, lastPos.y);
+	}
+	chunk->swap_remove(id);
+	count--;
+
+	if(chunk->size() == 0)
+	{
+		chunks.erase(key_of(chunk->coord));
+		return;
+	}
+
+	// The moved plant's wake-up still refers to its old id
+	if(id != last && int32_t(chunk->due[id] - now()) > 0)
+		wheel.schedule(chunk->due[id], Wake { key_of(chunk->coord), id });
+}
+
+void Garden::clear()
+{
+	chunks.clear();
+	count = 0;
+	wheel.clear(now());
+}
+
+void Garden::assign(std::vector<Plant> const & plants)
+{
+	clear();
+	for(auto const & plant : plants)
+		add(plant);
+}
+
+void Garden::gather(std::vector<Plant> & plants) const
+{
+	plants.reserve(plants.size() + count);
+
+	std::vector<float> growth, watering;
+	for(auto const & it : chunks)
+	{
+		auto const & chunk = *it.second;
+		growth.resize(chunk.size());
+		watering.resize(chunk.size());
+		GrowPlants(
+			chunk.growth.data(), chunk.watering.data(), chunk.growspeed.data(),
+			chunk.since.data(), now(), growth.data(), watering.data(), chunk.size());
+		for(uint32_t id = 0; id < chunk.size(); id++)
+			plants.push_back(Plant { chunk.type[id], chunk.position[id], double(growth[id]), double(watering[id]) });
+	}
+}
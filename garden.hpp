@@ -0,0 +1,179 @@
+#ifndef GARDEN_HPP
+#define GARDEN_HPP
+
+#include "plant.hpp"
+#include "spatialgrid.hpp"
+#include "depthbuckets.hpp"
+#include "timingwheel.hpp"
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+// Unbounded plant storage, split into square chunks. Every chunk keeps
+// its own plants and indices, so memory only grows with the planted
+// area and queries only touch the chunks around them.
+//
+// Plants are not updated every tick. Their growth and watering are
+// stored as of the tick they were last touched and evaluated on demand,
+// and a timing wheel wakes each plant at the tick it reaches its next
+// stage. An idle garden costs nothing per tick, however big it is.
+class Garden
+{
+public:
+	static int const chunk_size = 64;
+
+	// Plants are stored as structure of arrays, all indexed by the same
+	// plant id.
+	struct Chunk
+	{
+		glm::ivec2 coord;
+
+		// Read by clicks and drawing. stage caches the stage index.
+		std::vector<int> type;
+		std::vector<glm::ivec2> position;
+		std::vector<uint8_t> stage;
+
+		// growth and watering as of tick since, growspeed is copied
+		// from the plant type. due is the tick of the next wake-up.
+		std::vector<float> growth;
+		std::vector<float> watering;
+		std::vector<float> growspeed;
+		std::vector<uint32_t> since;
+		std::vector<uint32_t> due;
+
+		// Plant ids
+		SpatialGrid grid;
+		DepthBuckets depth;
+
+		size_t size() const { return type.size(); }
+
+		// The plant as of tick now
+		Plant plant(uint32_t id, uint32_t now) const;
+
+		void resize(size_t count);
+		void swap_remove(uint32_t id);
+	};
+
+	// Refers to a single plant, only valid until the next add or remove
+	struct Ref
+	{
+		Chunk * chunk;
+		uint32_t id;
+
+		explicit operator bool() const { return chunk != nullptr; }
+	};
+
+private:
+	struct Wake
+	{
+		uint64_t chunk;
+		uint32_t id;
+	};
+
+	std::unordered_map<uint64_t, std::unique_ptr<Chunk>> chunks;
+	size_t count;
+	TimingWheel<Wake> wheel;
+
+	// Brings growth and watering of a plant up to the current tick
+	void rebase(Chunk & chunk, uint32_t id);
+
+	// Schedules the wake-up for the next stage change, if there is one
+	void schedule(Chunk & chunk, uint32_t id);
+
+public:
+	Garden();
+	Garden(Garden const &) = delete;
+
+	static uint64_t key_of(glm::ivec2 coord)
+	{
+		return (uint64_t(uint32_t(coord.x)) << 32) | uint64_t(uint32_t(coord.y));
+	}
+
+	static int chunk_of(int v)
+	{
+		return (v >= 0 ? v : v - chunk_size + 1) / chunk_size;
+	}
+
+	static glm::ivec2 chunk_of(glm::ivec2 pos)
+	{
+		return glm::ivec2(chunk_of(pos.x), chunk_of(pos.y));
+	}
+
+	Chunk * find_chunk(glm::ivec2 coord) const;
+
+	size_t size() const { return count; }
+
+	// Returns the plant closest to pos within radius or an empty Ref
+	Ref nearest(glm::ivec2 pos, float radius) const;
+
+	uint32_t now() const { return wheel.now(); }
+
+	Plant get(Ref ref) const { return ref.chunk->plant(ref.id, now()); }
+
+	// Replaces a plant, its position must not change
+	void set(Ref ref, Plant const & plant);
+
+	// Moves to the next tick and appends the position of every plant
+	// that reached a new stage to changed
+	void advance(std::vector<glm::ivec2> & changed);
+
+	void add(Plant const & plant);
+
+	void remove(Ref ref);
+
+	void clear();
+
+	// Replaces all plants
+	void assign(std::vector<Plant> const & plants);
+
+	// Appends all plants to plants
+	void gather(std::vector<Plant> & plants) const;
+
+	template<typename F>
+	void for_each_chunk(F && fn)
+	{
+		for(auto & it : chunks)
+			fn(*it.second);
+	}
+
+	// Calls fn(chunk, id) for all plants with x0 <= x < x1 and
+	// y0 <= y < y1, back to front
+	template<typename F>
+	void for_each_in(int x0, int x1, int y0, int y1, F && fn) const
+	{
+		if(x0 >= x1 || y0 >= y1)
+			return;
+		int const cx0 = chunk_of(x0), cx1 = chunk_of(x1 - 1);
+		int const cy0 = chunk_of(y0), cy1 = chunk_of(y1 - 1);
+
+		std::vector<Chunk const *> row;
+		for(int cy = cy0; cy <= cy1; cy++)
+		{
+			row.clear();
+			for(int cx = cx0; cx <= cx1; cx++)
+			{
+				auto const * chunk = find_chunk(glm::ivec2(cx, cy));
+				if(chunk != nullptr)
+					row.push_back(chunk);
+			}
+			if(row.empty())
+				continue;
+
+			int const top = std::max(y0, cy * chunk_size);
+			int const bottom = std::min(y1, (cy + 1) * chunk_size);
+			for(int y = top; y < bottom; y++)
+			{
+				for(auto const * chunk : row)
+				{
+					chunk->depth.for_each_in(x0, x1, y, y + 1, [&](uint32_t id)
+					{
+						fn(*chunk, id);
+					});
+				}
+			}
+		}
+	}
+};
+
+#endif // GARDEN_HPP
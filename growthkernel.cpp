@@ -0,0 +1,120 @@
+#include "growthkernel.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define GROWTH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(GROWTH_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define GROWTH_AVX2
+#include <immintrin.h>
+#endif
+
+static void grow_scalar(
+	float const * growth, float const * watering, float const * growspeed,
+	uint32_t const * since, uint32_t now, float * growthOut, float * wateringOut,
+	size_t begin, size_t end)
+{
+	for(size_t i = begin; i < end; i++)
+		GrowPlant(growth[i], watering[i], growspeed[i], since[i], now, growthOut[i], wateringOut[i]);
+}
+
+#ifdef GROWTH_SSE2
+static void grow_sse2(
+	float const * growth, float const * watering, float const * growspeed,
+	uint32_t const * since, uint32_t now, float * growthOut, float * wateringOut,
+	size_t count)
+{
+	__m128 const zero = _mm_setzero_ps();
+	__m128i const ticks = _mm_set1_epi32(int(now));
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4)
+	{
+		__m128i const elapsed = _mm_sub_epi32(ticks, _mm_loadu_si128(reinterpret_cast<__m128i const *>(since + i)));
+		__m128 const grown = _mm_mul_ps(_mm_loadu_ps(growspeed + i), _mm_cvtepi32_ps(elapsed));
+		__m128 const w = _mm_loadu_ps(watering + i);
+		__m128 d = _mm_min_ps(w, grown);
+		d = _mm_max_ps(d, zero);
+		_mm_storeu_ps(growthOut + i, _mm_add_ps(_mm_loadu_ps(growth + i), d));
+		_mm_storeu_ps(wateringOut + i, _mm_sub_ps(w, d));
+	}
+	grow_scalar(growth, watering, growspeed, since, now, growthOut, wateringOut, i, count);
+}
+#endif
+
+#ifdef GROWTH_AVX2
+__attribute__((target("avx2")))
+static void grow_avx2(
+	float const * growth, float const * watering, float const * growspeed,
+	uint32_t const * since, uint32_t now, float * growthOut, float * wateringOut,
+	size_t count)
+{
+	__m256 const zero = _mm256_setzero_ps();
+	__m256i const ticks = _mm256_set1_epi32(int(now));
+	size_t i = 0;
+	for(; i + 8 <= count; i += 8)
+	{
+		__m256i const elapsed = _mm256_sub_epi32(ticks, _mm256_loadu_si256(reinterpret_cast<__m256i const *>(since + i)));
+		__m256 const grown = _mm256_mul_ps(_mm256_loadu_ps(growspeed + i), _mm256_cvtepi32_ps(elapsed));
+		__m256 const w = _mm256_loadu_ps(watering + i);
+		__m256 d = _mm256_min_ps(w, grown);
+		d = _mm256_max_ps(d, zero);
+		_mm256_storeu_ps(growthOut + i, _mm256_add_ps(_mm256_loadu_ps(growth + i), d));
+		_mm256_storeu_ps(wateringOut + i, _mm256_sub_ps(w, d));
+	}
+	grow_scalar(growth, watering, growspeed, since, now, growthOut, wateringOut, i, count);
+}
+#endif
+
+#ifndef GROWTH_SSE2
+static void grow_portable(
+	float const * growth, float const * watering, float const * growspeed,
+	uint32_t const * since, uint32_t now, float * growthOut, float * wateringOut,
+	size_t count)
+{
+	grow_scalar(growth, watering, growspeed, since, now, growthOut, wateringOut, 0, count);
+}
+#endif
+
+using Kernel = void (*)(float const *, float const *, float const *, uint32_t const *, uint32_t, float *, float *, size_t);
+
+struct KernelChoice
+{
+	Kernel kernel;
+	char const * name;
+};
+
+static KernelChoice pick_kernel()
+{
+#ifdef GROWTH_AVX2
+	// Runs during static initialization, possibly before libgcc's own
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2"))
+		return KernelChoice { grow_avx2, "avx2" };
+#endif
+#ifdef GROWTH_SSE2
+	return KernelChoice { grow_sse2, "sse2" };
+#else
+	return KernelChoice { grow_portable, "scalar" };
+#endif
+}
+
+static KernelChoice const kernel = pick_kernel();
+
+void GrowPlants(
+	float const * growth,
+	float const * watering,
+	float const * growspeed,
+	uint32_t const * since,
+	uint32_t now,
+	float * growthOut,
+	float * wateringOut,
+	size_t count)
+{
+	kernel.kernel(growth, watering, growspeed, since, now, growthOut, wateringOut, count);
+}
+
+char const * GrowPlantsKernel()
+{
+	return kernel.name;
+}
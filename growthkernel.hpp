@@ -0,0 +1,41 @@
+#ifndef GROWTHKERNEL_HPP
+#define GROWTHKERNEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Plants grow by min(watering, growspeed) per tick, so a plant that
+// had growth and watering at tick since has moved
+//
+//   d = max(0, min(watering, growspeed * (now - since)))
+//
+// from watering to growth at tick now. GrowPlant() evaluates that for a
+// single plant, GrowPlants() for count plants at once without branches,
+// using AVX2 or SSE2 where the CPU has them. Both give bit-identical
+// results. Ticks may wrap around, now - since must stay below 2^31.
+static inline void GrowPlant(
+	float growth, float watering, float growspeed, uint32_t since, uint32_t now,
+	float & growthOut, float & wateringOut)
+{
+	// Same operand order as minps/maxps, so every path rounds alike
+	float const grown = growspeed * float(int32_t(now - since));
+	float d = (watering < grown) ? watering : grown;
+	d = (d > 0.0f) ? d : 0.0f;
+	growthOut = growth + d;
+	wateringOut = watering - d;
+}
+
+void GrowPlants(
+	float const * growth,
+	float const * watering,
+	float const * growspeed,
+	uint32_t const * since,
+	uint32_t now,
+	float * growthOut,
+	float * wateringOut,
+	size_t count);
+
+// Name of the implementation GrowPlants() picked, for benchmarks
+char const * GrowPlantsKernel();
+
+#endif // GROWTHKERNEL_HPP
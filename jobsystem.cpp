@@ -0,0 +1,130 @@
+#include "jobsystem.hpp"
+
+#include <algorithm>
+
+JobSystem::JobSystem(size_t threads) :
+	queues(),
+	workers(),
+	queued(0),
+	stopping(false)
+{
+	if(threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for(size_t i = 0; i < threads; i++)
+		queues.emplace_back(new Queue());
+	for(size_t i = 1; i < threads; i++)
+		workers.emplace_back(&JobSystem::work, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> _l(sleep_mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for(auto & t : workers)
+		t.join();
+}
+
+bool JobSystem::pop(size_t self, Job & job)
+{
+	if(queued.load() == 0)
+		return false;
+
+	// Own queue first, newest job first while its data is still in cache
+	{
+		auto & queue = *queues[self];
+		std::lock_guard<std::mutex> _l(queue.mutex);
+		if(!queue.jobs.empty())
+		{
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+			queued--;
+			return true;
+		}
+	}
+
+	// Steal the oldest job of another queue
+	for(size_t i = 1; i < queues.size(); i++)
+	{
+		auto & queue = *queues[(self + i) % queues.size()];
+		std::lock_guard<std::mutex> _l(queue.mutex);
+		if(!queue.jobs.empty())
+		{
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+			queued--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::work(size_t self)
+{
+	while(true)
+	{
+		Job job;
+		if(pop(self, job))
+		{
+			job.run(job.fn, job.begin, job.end);
+			job.pending->fetch_sub(1, std::memory_order_release);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> _l(sleep_mutex);
+		wake.wait(_l, [this]() { return stopping || queued.load() > 0; });
+		if(stopping)
+			return;
+	}
+}
+
+void JobSystem::run(size_t count, size_t grain, Job const & prototype)
+{
+	size_t const ranges = (count + grain - 1) / grain;
+	std::atomic<size_t> pending(ranges);
+
+	// Every queue gets a contiguous block of ranges, stealing
+	// evens out whatever imbalance remains.
+	size_t const perQueue = (ranges + queues.size() - 1) / queues.size();
+	for(size_t q = 0; q < queues.size(); q++)
+	{
+		size_t const first = q * perQueue;
+		size_t const last = std::min(ranges, first + perQueue);
+		if(first >= last)
+			break;
+
+		auto & queue = *queues[q];
+		std::lock_guard<std::mutex> _l(queue.mutex);
+		for(size_t r = first; r < last; r++)
+		{
+			Job job = prototype;
+			job.begin = r * grain;
+			job.end = std::min(count, job.begin + grain);
+			job.pending = &pending;
+			queue.jobs.push_back(job);
+		}
+		queued += last - first;
+	}
+	{
+		std::lock_guard<std::mutex> _l(sleep_mutex);
+	}
+	wake.notify_all();
+
+	// Help out until the whole batch is done
+	while(pending.load(std::memory_order_acquire) > 0)
+	{
+		Job job;
+		if(pop(0, job))
+		{
+			job.run(job.fn, job.begin, job.end);
+			job.pending->fetch_sub(1, std::memory_order_release);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
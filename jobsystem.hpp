@@ -0,0 +1,87 @@
+#ifndef JOBSYSTEM_HPP
+#define JOBSYSTEM_HPP
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Worker threads with one job queue each. A thread takes jobs from the
+// back of its own queue and steals from the front of the others when it
+// runs dry, so uneven ranges still keep every core busy.
+//
+// Jobs are submitted from a single thread, which need not be the one
+// that created the JobSystem. It owns queue 0 and helps working through
+// the jobs until its own batch is done. In the game that is the
+// simulation thread.
+class JobSystem
+{
+private:
+	struct Job
+	{
+		void (*run)(void const * fn, size_t begin, size_t end);
+		void const * fn;
+		size_t begin;
+		size_t end;
+		std::atomic<size_t> * pending;
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	// Queue 0 belongs to the submitting thread
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex sleep_mutex;
+	std::condition_variable wake;
+	std::atomic<size_t> queued;
+	bool stopping;
+
+	bool pop(size_t self, Job & job);
+
+	void work(size_t self);
+
+	// Splits [0, count) into ranges of grain and runs them all
+	void run(size_t count, size_t grain, Job const & prototype);
+
+public:
+	// threads 0 uses one thread per core, the calling thread included
+	explicit JobSystem(size_t threads = 0);
+	JobSystem(JobSystem const &) = delete;
+	~JobSystem();
+
+	size_t size() const { return workers.size() + 1; }
+
+	// Calls fn(begin, end) for consecutive ranges of at most grain
+	// elements covering [0, count) and returns once all calls returned.
+	// Every element is handled exactly once, so the result does not
+	// depend on which thread ran which range.
+	template<typename F>
+	void parallel_for(size_t count, size_t grain, F const & fn)
+	{
+		if(count == 0)
+			return;
+		if(count <= grain || workers.empty())
+		{
+			fn(size_t(0), count);
+			return;
+		}
+
+		Job prototype;
+		prototype.run = [](void const * f, size_t begin, size_t end)
+		{
+			(*static_cast<F const *>(f))(begin, end);
+		};
+		prototype.fn = &fn;
+		run(count, grain, prototype);
+	}
+};
+
+#endif // JOBSYSTEM_HPP
@@ -0,0 +1,78 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include "engine.h"
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#ifdef _WIN32
+#include <cstdio>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file, memory mapped where possible
+class MappedFile
+{
+private:
+	uint8_t const * bytes;
+	size_t length;
+#ifdef _WIN32
+	std::vector<uint8_t> buffer;
+#endif
+
+public:
+	explicit MappedFile(char const * fileName) : bytes(nullptr), length(0)
+	{
+#ifdef _WIN32
+		FILE * f = fopen(fileName, "rb");
+		if(f == nullptr)
+			die(("Could not open " + std::string(fileName)).c_str());
+		fseek(f, 0, SEEK_END);
+		buffer.resize(size_t(ftell(f)));
+		fseek(f, 0, SEEK_SET);
+		if(fread(buffer.data(), 1, buffer.size(), f) != buffer.size())
+			die(("Could not read " + std::string(fileName)).c_str());
+		fclose(f);
+		bytes = buffer.data();
+		length = buffer.size();
+#else
+		int fd = open(fileName, O_RDONLY);
+		if(fd < 0)
+			die(("Could not open " + std::string(fileName)).c_str());
+		struct stat info;
+		if(fstat(fd, &info) < 0)
+			die(("Could not stat " + std::string(fileName)).c_str());
+		length = size_t(info.st_size);
+		if(length > 0)
+		{
+			void * map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(map == MAP_FAILED)
+				die(("Could not map " + std::string(fileName)).c_str());
+			madvise(map, length, MADV_SEQUENTIAL);
+			bytes = static_cast<uint8_t const *>(map);
+		}
+		close(fd);
+#endif
+	}
+
+	MappedFile(MappedFile const &) = delete;
+
+	~MappedFile()
+	{
+#ifndef _WIN32
+		if(bytes != nullptr)
+			munmap(const_cast<uint8_t *>(bytes), length);
+#endif
+	}
+
+	uint8_t const * data() const { return bytes; }
+	size_t size() const { return length; }
+};
+
+#endif // MAPPEDFILE_HPP
@@ -1,5 +1,5 @@
 TEMPLATE = app
-CONFIG += console c++14
+CONFIG += console c++14 thread
 CONFIG -= app_bundle
 CONFIG -= qt
 
@@ -11,9 +11,52 @@ QMAKE_LFLAGS   += $$system(pkg-config --libs $$PACKAGES)
 
 SOURCES += \
     engine.cpp \
-    game.cpp
+    game.cpp \
+    particles.cpp \
+    atlas.cpp \
+    assetloader.cpp \
+    catalog.cpp \
+    savegame.cpp \
+    autosave.cpp \
+    garden.cpp \
+    framescheduler.cpp \
+    trace.cpp \
+    profiler.cpp \
+    jobsystem.cpp \
+    growthkernel.cpp \
+    voices.cpp \
+    resources.cpp \
+    text.cpp \
+    renderqueue.cpp \
+    softraster.cpp \
+    pack.cpp
 
 HEADERS += \
     engine.h \
     game.hpp \
-    palette.h
+    palette.h \
+    spatialgrid.hpp \
+    depthbuckets.hpp \
+    particles.hpp \
+    atlas.hpp \
+    assetloader.hpp \
+    catalog.hpp \
+    plant.hpp \
+    savegame.hpp \
+    autosave.hpp \
+    garden.hpp \
+    framescheduler.hpp \
+    trace.hpp \
+    profiler.hpp \
+    jobsystem.hpp \
+    growthkernel.hpp \
+    timingwheel.hpp \
+    voices.hpp \
+    resources.hpp \
+    text.hpp \
+    renderqueue.hpp \
+    triplebuffer.hpp \
+    spscqueue.hpp \
+    softraster.hpp \
+    mappedfile.hpp \
+    pack.hpp
@@ -0,0 +1,177 @@
+#include "pack.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include <sys/stat.h>
+
+static uint32_t const pack_version = 1;
+static char const pack_magic[8] = { 'M', 'L', 'G', 'P', 'A', 'C', 'K', '\0' };
+
+static size_t const header_size = 32;
+static size_t const entry_size = 32;
+static size_t const data_alignment = 16;
+
+// FNV-1a, only guards against truncated or foreign files
+static uint32_t checksum(uint8_t const * data, size_t length)
+{
+	uint32_t hash = 2166136261u;
+	for(size_t i = 0; i < length; i++)
+		hash = (hash ^ data[i]) * 16777619u;
+	return hash;
+}
+
+static void put_u32(uint8_t * p, uint32_t v)
+{
+	p[0] = uint8_t(v);
+	p[1] = uint8_t(v >> 8);
+	p[2] = uint8_t(v >> 16);
+	p[3] = uint8_t(v >> 24);
+}
+
+static void put_u64(uint8_t * p, uint64_t v)
+{
+	put_u32(p, uint32_t(v));
+	put_u32(p + 4, uint32_t(v >> 32));
+}
+
+static uint32_t get_u32(uint8_t const * p)
+{
+	return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static uint64_t get_u64(uint8_t const * p)
+{
+	return uint64_t(get_u32(p)) | (uint64_t(get_u32(p + 4)) << 32);
+}
+
+static uint64_t align(uint64_t offset)
+{
+	return (offset + data_alignment - 1) & ~uint64_t(data_alignment - 1);
+}
+
+void WritePack(char const * fileName, PackAudioSpec const & spec, std::vector<PackEntry> const & entries)
+{
+	uint64_t namesSize = 0;
+	for(auto const & entry : entries)
+		namesSize += entry.name.size();
+
+	std::vector<uint8_t> head(header_size + entry_size * entries.size() + namesSize, 0);
+	memcpy(head.data(), pack_magic, sizeof pack_magic);
+	put_u32(head.data() + 8, pack_version);
+	put_u32(head.data() + 12, uint32_t(entries.size()));
+	put_u32(head.data() + 16, uint32_t(spec.frequency));
+	put_u32(head.data() + 20, spec.format);
+	put_u32(head.data() + 24, uint32_t(spec.channels));
+	put_u32(head.data() + 28, checksum(head.data(), 28));
+
+	uint8_t * p = head.data() + header_size;
+	uint8_t * names = p + entry_size * entries.size();
+	uint64_t offset = align(head.size());
+	for(auto const & entry : entries)
+	{
+		put_u32(p + 0, uint32_t(entry.kind));
+		put_u32(p + 4, uint32_t(entry.width));
+		put_u32(p + 8, uint32_t(entry.height));
+		put_u32(p + 12, uint32_t(entry.name.size()));
+		put_u64(p + 16, offset);
+		put_u64(p + 24, entry.data.size());
+		p += entry_size;
+
+		memcpy(names, entry.name.data(), entry.name.size());
+		names += entry.name.size();
+		offset = align(offset + entry.data.size());
+	}
+
+	FILE * f = fopen(fileName, "wb");
+	if(f == nullptr)
+		die("Could not open asset pack");
+
+	static uint8_t const padding[data_alignment] = { };
+	fwrite(head.data(), head.size(), 1, f);
+	uint64_t written = head.size();
+	for(auto const & entry : entries)
+	{
+		fwrite(padding, size_t(align(written) - written), 1, f);
+		written = align(written);
+		fwrite(entry.data.data(), entry.data.size(), 1, f);
+		written += entry.data.size();
+	}
+
+	if(fclose(f) != 0)
+		die("Could not write asset pack");
+}
+
+AssetPack::AssetPack(char const * fileName) :
+	file(fileName), spec(PackAudioSpec { 0, 0, 0 }), blobs()
+{
+	auto const * data = file.data();
+	auto const size = file.size();
+	if(size < header_size || memcmp(data, pack_magic, sizeof pack_magic) != 0)
+		die("Not an asset pack");
+	if(get_u32(data + 8) != pack_version)
+		die("Unsupported asset pack version, bake the assets again");
+	if(get_u32(data + 28) != checksum(data, 28))
+		die("Asset pack header is corrupt");
+
+	size_t const count = get_u32(data + 12);
+	spec = PackAudioSpec { int(get_u32(data + 16)), Uint16(get_u32(data + 20)), int(get_u32(data + 24)) };
+
+	size_t names = header_size + entry_size * count;
+	if(names > size)
+		die("Asset pack is truncated");
+	for(size_t i = 0; i < count; i++)
+	{
+		auto const * p = data + header_size + entry_size * i;
+		size_t const nameLength = get_u32(p + 12);
+		uint64_t const offset = get_u64(p + 16);
+		uint64_t const length = get_u64(p + 24);
+		if(names + nameLength > size || offset > size || length > size - offset)
+			die("Asset pack is truncated");
+
+		Blob blob {
+			PackEntry::Kind(get_u32(p + 0)),
+			int(get_u32(p + 4)), int(get_u32(p + 8)),
+			data + offset, size_t(length)
+		};
+		if(blob.kind == PackEntry::ImageData && uint64_t(blob.width) * uint64_t(blob.height) * 4 != length)
+			die("Asset pack image has the wrong size");
+
+		blobs.emplace(std::string(reinterpret_cast<char const *>(data + names), nameLength), blob);
+		names += nameLength;
+	}
+}
+
+AssetPack::Blob const * AssetPack::find(std::string const & name) const
+{
+	auto it = blobs.find(name);
+	return (it != blobs.end()) ? &it->second : nullptr;
+}
+
+size_t AssetPack::drop_older_than_files(time_t packTime)
+{
+	// Only a stat per file, nothing is opened
+	size_t dropped = 0;
+	for(auto it = blobs.begin(); it != blobs.end();)
+	{
+		struct stat info;
+		if(stat(it->first.c_str(), &info) == 0 && info.st_mtime > packTime)
+		{
+			fprintf(stderr, "%s is newer than the asset pack, loading it from disk\n", it->first.c_str());
+			it = blobs.erase(it);
+			dropped++;
+			continue;
+		}
+		++it;
+	}
+	return dropped;
+}
+
+bool AssetPack::sounds_match_mixer() const
+{
+	int frequency, channels;
+	Uint16 format;
+	if(Mix_QuerySpec(&frequency, &format, &channels) == 0)
+		return false;
+	return frequency == spec.frequency && format == spec.format && channels == spec.channels;
+}
@@ -0,0 +1,82 @@
+#ifndef PACK_HPP
+#define PACK_HPP
+
+#include "engine.h"
+#include "mappedfile.hpp"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <ctime>
+
+// Asset pack layout, all values little endian:
+//
+//   header   magic "MLGPACK\0", u32 version, u32 entry count,
+//            u32 sample rate, u32 sample format, u32 channels,
+//            u32 header checksum
+//   entry    u32 kind, i32 width, i32 height, u32 name length,
+//            u64 data offset, u64 data size
+//   names    the entry names one after another, without terminators
+//   data     16 byte aligned blobs
+//
+// Images are ARGB8888 rows without padding, sounds are samples in the
+// mixer format given in the header. Names are the paths the game asks
+// the ResourceCache for, e.g. "data/click.wav".
+
+struct PackEntry
+{
+	enum Kind { ImageData = 0, SoundData = 1 };
+
+	Kind kind;
+	std::string name;
+	int width, height;
+	std::vector<uint8_t> data;
+};
+
+struct PackAudioSpec
+{
+	int frequency;
+	Uint16 format;
+	int channels;
+};
+
+// Used by the bake tool in baker/, dies on errors
+void WritePack(char const * fileName, PackAudioSpec const & spec, std::vector<PackEntry> const & entries);
+
+// A pack mapped into memory. Images and sounds are used straight from
+// the mapping, so it has to outlive everything loaded from it.
+class AssetPack
+{
+public:
+	struct Blob
+	{
+		PackEntry::Kind kind;
+		int width, height;
+		uint8_t const * data;
+		size_t size;
+	};
+
+private:
+	MappedFile file;
+	PackAudioSpec spec;
+	std::unordered_map<std::string, Blob> blobs;
+
+public:
+	// Dies on corrupt files
+	explicit AssetPack(char const * fileName);
+	AssetPack(AssetPack const &) = delete;
+
+	Blob const * find(std::string const & name) const;
+
+	// Forgets entries whose file was modified after packTime, so edits
+	// show up without baking again. Returns how many were dropped.
+	size_t drop_older_than_files(time_t packTime);
+
+	// Sounds are only usable if the mixer was opened with the same format
+	bool sounds_match_mixer() const;
+
+	size_t size() const { return blobs.size(); }
+};
+
+#endif // PACK_HPP
@@ -0,0 +1,160 @@
+#include "particles.hpp"
+#include "renderqueue.hpp"
+#include "palette.h"
+
+Particle::Particle() : lifespan(1), pos(), vel(), accel(), color{BLUE}
+{
+}
+
+ParticlePool::ParticlePool(size_t capacity) :
+	capacity(capacity),
+	count(0),
+	pos_x(capacity), pos_y(capacity),
+	vel_x(capacity), vel_y(capacity),
+	accel_x(capacity), accel_y(capacity),
+	lifespan(capacity),
+	color(capacity)
+{
+}
+
+void ParticlePool::spawn(Particle const & p)
+{
+	auto const i = count++;
+	pos_x[i] = p.pos.x;
+	pos_y[i] = p.pos.y;
+	vel_x[i] = p.vel.x;
+	vel_y[i] = p.vel.y;
+	accel_x[i] = p.accel.x;
+	accel_y[i] = p.accel.y;
+	lifespan[i] = p.lifespan;
+	color[i] = p.color;
+}
+
+void ParticlePool::update()
+{
+	integrate(0, count);
+	remove_dead();
+}
+
+void ParticlePool::integrate(size_t begin, size_t end)
+{
+	// Plain loops over restrict pointers, so the compiler is free
+	// to vectorize every one of them.
+	{
+		int * __restrict life = lifespan.data();
+		for(size_t i = begin; i < end; i++)
+			life[i] -= 1;
+	}
+	{
+		float * __restrict px = pos_x.data();
+		float * __restrict py = pos_y.data();
+		float const * __restrict vx = vel_x.data();
+		float const * __restrict vy = vel_y.data();
+		for(size_t i = begin; i < end; i++)
+		{
+			px[i] += vx[i];
+			py[i] += vy[i];
+		}
+	}
+	{
+		float * __restrict vx = vel_x.data();
+		float * __restrict vy = vel_y.data();
+		float const * __restrict ax = accel_x.data();
+		float const * __restrict ay = accel_y.data();
+		for(size_t i = begin; i < end; i++)
+		{
+			vx[i] += ax[i];
+			vy[i] += ay[i];
+		}
+	}
+}
+
+void ParticlePool::remove_dead()
+{
+	// Swap-remove dead particles
+	size_t i = 0;
+	while(i < count)
+	{
+		if(lifespan[i] > 0)
+		{
+			i++;
+			continue;
+		}
+		auto const last = --count;
+		pos_x[i] = pos_x[last];
+		pos_y[i] = pos_y[last];
+		vel_x[i] = vel_x[last];
+		vel_y[i] = vel_y[last];
+		accel_x[i] = accel_x[last];
+		accel_y[i] = accel_y[last];
+		lifespan[i] = lifespan[last];
+		color[i] = color[last];
+	}
+}
+
+static bool operator==(Color const & a, Color const & b)
+{
+	return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+void ParticlePool::snapshot(ParticleSnapshot & out) const
+{
+	out.count = count;
+	out.pos_x.assign(pos_x.begin(), pos_x.begin() + count);
+	out.pos_y.assign(pos_y.begin(), pos_y.begin() + count);
+	out.vel_x.assign(vel_x.begin(), vel_x.begin() + count);
+	out.vel_y.assign(vel_y.begin(), vel_y.begin() + count);
+	out.color.assign(color.begin(), color.begin() + count);
+}
+
+ParticleSnapshot::ParticleSnapshot() :
+	count(0),
+	pos_x(), pos_y(),
+	vel_x(), vel_y(),
+	color(),
+	batches()
+{
+}
+
+void ParticleSnapshot::draw(glm::ivec2 offset, float alpha) const
+{
+	for(auto & batch : batches)
+		batch.points.clear();
+
+	// Particles only ever use a handful of palette colors, so a linear
+	// search with a one-entry cache beats any kind of map here.
+	Batch * current = nullptr;
+	for(size_t i = 0; i < count; i++)
+	{
+		if(current == nullptr || !(current->color == color[i]))
+		{
+			current = nullptr;
+			for(auto & batch : batches)
+			{
+				if(batch.color == color[i])
+				{
+					current = &batch;
+					break;
+				}
+			}
+			if(current == nullptr)
+			{
+				batches.push_back(Batch { color[i], std::vector<SDL_Point>() });
+				batches.back().points.reserve(count);
+				current = &batches.back();
+			}
+		}
+		current->points.push_back(SDL_Point {
+			int(pos_x[i] + alpha * vel_x[i] + 0.5f) + offset.x,
+			int(pos_y[i] + alpha * vel_y[i] + 0.5f) + offset.y
+		});
+	}
+
+	for(auto const & batch : batches)
+	{
+		if(batch.points.empty())
+			continue;
+		SDL_Color const color { batch.color.r, batch.color.g, batch.color.b, 0xFF };
+		renderQueue.points(batch.points.data(), batch.points.size(), color);
+	}
+}
@@ -0,0 +1,100 @@
+#ifndef PARTICLES_HPP
+#define PARTICLES_HPP
+
+#include "engine.h"
+
+#include <vector>
+
+struct Color { Uint8 r, g, b; };
+
+// Initial state of a single particle, handed to the emit() callback
+struct Particle
+{
+	int lifespan;
+	glm::vec2 pos;
+	glm::vec2 vel;
+	glm::vec2 accel;
+	Color color;
+
+	Particle();
+};
+
+// Copy of the drawable state of a ParticlePool, so the particles can be
+// drawn on another thread while the pool keeps simulating.
+class ParticleSnapshot
+{
+private:
+	friend class ParticlePool;
+
+	size_t count;
+	std::vector<float> pos_x, pos_y;
+	std::vector<float> vel_x, vel_y;
+	std::vector<Color> color;
+
+	// Scratch buffers for draw(), one per distinct color
+	struct Batch
+	{
+		Color color;
+		std::vector<SDL_Point> points;
+	};
+	mutable std::vector<Batch> batches;
+
+public:
+	ParticleSnapshot();
+
+	// Draws all particles as points moved by offset, with one draw call
+	// per color. alpha extrapolates the positions by a fraction of a tick.
+	void draw(glm::ivec2 offset = glm::ivec2(), float alpha = 0.0f) const;
+};
+
+// Fixed-capacity particle storage in structure-of-arrays layout.
+// Nothing is allocated after construction, dead particles are
+// swap-removed and new particles are dropped when the pool is full.
+class ParticlePool
+{
+private:
+	size_t capacity;
+	size_t count;
+
+	std::vector<float> pos_x, pos_y;
+	std::vector<float> vel_x, vel_y;
+	std::vector<float> accel_x, accel_y;
+	std::vector<int> lifespan;
+	std::vector<Color> color;
+
+	void spawn(Particle const & p);
+
+public:
+	explicit ParticlePool(size_t capacity);
+
+	size_t size() const { return count; }
+
+	template<typename F>
+	void emit(int amount, F && init)
+	{
+		for(int i = 0; i < amount && count < capacity; i++)
+		{
+			Particle p;
+			init(p);
+			spawn(p);
+		}
+	}
+
+	void update();
+
+	// The two halves of update(). integrate() only touches the particles
+	// in [begin, end), so disjoint ranges can run in parallel.
+	void integrate(size_t begin, size_t end);
+	void remove_dead();
+
+	void clear() { count = 0; }
+
+	// Copies the living particles into out, reusing its memory
+	void snapshot(ParticleSnapshot & out) const;
+
+	float x(size_t i) const { return pos_x[i]; }
+	float y(size_t i) const { return pos_y[i]; }
+	Color const & colorOf(size_t i) const { return color[i]; }
+};
+
+#endif // PARTICLES_HPP
@@ -0,0 +1,17 @@
+#ifndef PLANT_HPP
+#define PLANT_HPP
+
+#include "catalog.hpp"
+
+struct Plant
+{
+	// index into the plant catalog, -1 for an empty hole
+	int _type;
+	glm::ivec2 position;
+	double growth;
+	double watering;
+
+	PlantType const & type() const;
+};
+
+#endif // PLANT_HPP
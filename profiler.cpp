@@ -0,0 +1,153 @@
+#include "profiler.hpp"
+#include "engine.h"
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+struct Marker
+{
+	char const * name;
+	Uint64 begin;
+	Uint64 end;
+	int thread;
+};
+
+// About 20 seconds of markers at 60 frames per second
+static size_t const marker_capacity = 1 << 15;
+static size_t const max_phases = 16;
+static size_t const history_size = 256;
+
+static std::mutex mutex;
+
+static std::vector<Marker> markers(marker_capacity);
+static size_t marker_count;
+static size_t marker_next;
+
+static ProfilePhase current[max_phases];
+static size_t current_count;
+static ProfilePhase last[max_phases];
+static size_t last_count;
+
+static float history[history_size];
+static size_t history_next;
+static Uint64 frame_start;
+
+static std::atomic<int> thread_count(0);
+
+static int thread_id()
+{
+	thread_local int id = ++thread_count;
+	return id;
+}
+
+static double to_ms(Uint64 ticks)
+{
+	return 1000.0 * double(ticks) / double(SDL_GetPerformanceFrequency());
+}
+
+void ProfileMarker(char const * name, Uint64 begin, Uint64 end)
+{
+	int const thread = thread_id();
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	markers[marker_next] = Marker { name, begin, end, thread };
+	marker_next = (marker_next + 1) % marker_capacity;
+	marker_count = std::min(marker_count + 1, marker_capacity);
+
+	for(size_t i = 0; i < current_count; i++)
+	{
+		if(current[i].name == name)
+		{
+			current[i].ms += to_ms(end - begin);
+			return;
+		}
+	}
+	if(current_count < max_phases)
+		current[current_count++] = ProfilePhase { name, to_ms(end - begin) };
+}
+
+void ProfileFrame()
+{
+	auto const now = SDL_GetPerformanceCounter();
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if(frame_start != 0)
+	{
+		history[history_next] = float(to_ms(now - frame_start));
+		history_next = (history_next + 1) % history_size;
+	}
+	frame_start = now;
+
+	std::copy(current, current + current_count, last);
+	last_count = current_count;
+	current_count = 0;
+}
+
+size_t ProfileLastFrame(ProfilePhase * phases, size_t max)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t const count = std::min(max, last_count);
+	std::copy(last, last + count, phases);
+	return count;
+}
+
+void ProfileFrameTimes(float * ms, size_t count)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for(size_t i = 0; i < count; i++)
+	{
+		if(count - i > history_size)
+		{
+			ms[i] = 0.0f;
+			continue;
+		}
+		ms[i] = history[(history_next + history_size - (count - i)) % history_size];
+	}
+}
+
+size_t ProfileExport(char const * fileName, double seconds)
+{
+	std::vector<Marker> copy;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		copy.reserve(marker_count);
+		size_t const first = (marker_next + marker_capacity - marker_count) % marker_capacity;
+		for(size_t i = 0; i < marker_count; i++)
+			copy.push_back(markers[(first + i) % marker_capacity]);
+	}
+
+	FILE * f = fopen(fileName, "w");
+	if(f == nullptr)
+		return 0;
+
+	auto const frequency = double(SDL_GetPerformanceFrequency());
+	auto const now = SDL_GetPerformanceCounter();
+	auto const window = Uint64(seconds * frequency);
+	auto const cutoff = (now > window) ? now - window : 0;
+
+	// Markers are stored as they end, so enclosing ones begin earlier
+	Uint64 origin = now;
+	for(auto const & m : copy)
+		origin = std::min(origin, m.begin);
+
+	size_t written = 0;
+	fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for(auto const & m : copy)
+	{
+		if(m.end < cutoff)
+			continue;
+		fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+			(written > 0) ? ",\n" : "",
+			m.name, m.thread,
+			1e6 * double(m.begin - origin) / frequency,
+			1e6 * double(m.end - m.begin) / frequency);
+		written++;
+	}
+	fprintf(f, "\n]}\n");
+	fclose(f);
+	return written;
+}
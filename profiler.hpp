@@ -0,0 +1,60 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <SDL.h>
+
+#include <cstddef>
+
+// Lightweight scoped timing markers.
+//
+// Every marker goes into a ring buffer holding the last few seconds,
+// which ProfileExport() writes as a Chrome trace_event file (open it in
+// chrome://tracing or Perfetto). Markers are also summed up per name and
+// frame for the in-game overlay. Names must be string literals, they are
+// compared by address.
+struct ProfilePhase
+{
+	char const * name;
+	double ms;
+};
+
+void ProfileMarker(char const * name, Uint64 begin, Uint64 end);
+
+// Closes the current frame, call once per presented frame
+void ProfileFrame();
+
+// Copies the per-name totals of the last finished frame in the order the
+// names first appeared, returns how many were copied.
+size_t ProfileLastFrame(ProfilePhase * phases, size_t max);
+
+// Copies the length of the last count frames in ms, oldest first.
+// Missing frames are 0.
+void ProfileFrameTimes(float * ms, size_t count);
+
+// Writes the markers of the last seconds, returns the number written
+size_t ProfileExport(char const * fileName, double seconds);
+
+class ProfileScope
+{
+private:
+	char const * name;
+	Uint64 start;
+
+public:
+	explicit ProfileScope(char const * name) : name(name), start(SDL_GetPerformanceCounter())
+	{
+	}
+	ProfileScope(ProfileScope const &) = delete;
+	~ProfileScope()
+	{
+		ProfileMarker(name, start, SDL_GetPerformanceCounter());
+	}
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+// Times the rest of the enclosing block
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(_profile_, __LINE__)(name)
+
+#endif // PROFILER_HPP
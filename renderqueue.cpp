@@ -0,0 +1,306 @@
+#include "renderqueue.hpp"
+#include "softraster.hpp"
+
+#include <algorithm>
+
+RenderQueue renderQueue;
+
+static uint16_t const frame_pass = 0xFFFF;
+
+RenderQueue::RenderQueue() :
+	current(State { nullptr, 0, false, SDL_Rect { 0, 0, 0, 0 } }), order(0), targets(),
+	commands(), vertexData(), indexData(), pointData(), garbage(),
+	last(Stats { 0, 0, 0, 0, 0 })
+{
+}
+
+void RenderQueue::set_target(Image target)
+{
+	current = State { target, 0, false, SDL_Rect { 0, 0, 0, 0 } };
+	if(target != nullptr && std::find(targets.begin(), targets.end(), target) == targets.end())
+		targets.push_back(target);
+}
+
+void RenderQueue::set_layer(int layer)
+{
+	current.layer = layer;
+}
+
+void RenderQueue::set_clip(SDL_Rect const * clip)
+{
+	current.clipped = (clip != nullptr);
+	current.clip = (clip != nullptr) ? *clip : SDL_Rect { 0, 0, 0, 0 };
+}
+
+void RenderQueue::restore(State const & state)
+{
+	set_target(state.target);
+	current = state;
+}
+
+void RenderQueue::order_barrier()
+{
+	order++;
+}
+
+RenderQueue::Command & RenderQueue::record(Kind kind, Image texture)
+{
+	uint16_t pass = frame_pass;
+	if(current.target != nullptr)
+		pass = uint16_t(std::find(targets.begin(), targets.end(), current.target) - targets.begin());
+
+	Command cmd { };
+	cmd.kind = kind;
+	cmd.blend = SDL_BLENDMODE_NONE;
+	cmd.clipped = current.clipped;
+	cmd.pass = pass;
+	cmd.order = order;
+	cmd.layer = current.layer;
+	cmd.target = current.target;
+	cmd.texture = texture;
+	cmd.clip = current.clip;
+	commands.push_back(cmd);
+	return commands.back();
+}
+
+void RenderQueue::clear(SDL_Color color)
+{
+	record(Clear, nullptr).color = color;
+}
+
+void RenderQueue::fill_rect(SDL_Rect const & rect, SDL_Color color, SDL_BlendMode blend)
+{
+	auto & cmd = record(FillRect, nullptr);
+	cmd.color = color;
+	cmd.blend = uint8_t(blend);
+	cmd.dest = rect;
+}
+
+void RenderQueue::line(glm::ivec2 from, glm::ivec2 to, SDL_Color color)
+{
+	// dest holds both end points
+	auto & cmd = record(Line, nullptr);
+	cmd.color = color;
+	cmd.dest = SDL_Rect { from.x, from.y, to.x, to.y };
+}
+
+void RenderQueue::points(SDL_Point const * list, size_t count, SDL_Color color)
+{
+	if(count == 0)
+		return;
+	auto & cmd = record(Points, nullptr);
+	cmd.color = color;
+	cmd.first = uint32_t(pointData.size());
+	cmd.count = uint32_t(count);
+	pointData.insert(pointData.end(), list, list + count);
+}
+
+void RenderQueue::copy(Image texture, SDL_Rect const * source, SDL_Rect const & dest)
+{
+	auto & cmd = record(Copy, texture);
+	cmd.whole = (source == nullptr);
+	if(source != nullptr)
+		cmd.source = *source;
+	cmd.dest = dest;
+}
+
+void RenderQueue::geometry(Image texture, SDL_Vertex const * list, size_t vertexCount, int const * indexList, size_t indexCount)
+{
+	if(indexCount == 0)
+		return;
+	auto & cmd = record(Geometry, texture);
+	cmd.first = uint32_t(vertexData.size());
+	cmd.count = uint32_t(vertexCount);
+	cmd.firstIndex = uint32_t(indexData.size());
+	cmd.indexCount = uint32_t(indexCount);
+	vertexData.insert(vertexData.end(), list, list + vertexCount);
+	indexData.insert(indexData.end(), indexList, indexList + indexCount);
+}
+
+void RenderQueue::destroy_later(Image texture)
+{
+	garbage.push_back(texture);
+}
+
+static bool same_clip(SDL_Rect const & a, SDL_Rect const & b)
+{
+	return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+void RenderQueue::submit()
+{
+	std::stable_sort(
+		commands.begin(), commands.end(),
+		[](Command const & l, Command const & r)
+		{
+			if(l.pass != r.pass)
+				return l.pass < r.pass;
+			if(l.layer != r.layer)
+				return l.layer < r.layer;
+			if(l.order != r.order)
+				return l.order < r.order;
+			return std::less<Image>()(l.texture, r.texture);
+		});
+
+	if(softRaster != nullptr)
+		last = rasterize();
+	else
+		last = execute();
+
+	for(auto dead : garbage)
+	{
+		if(softRaster != nullptr)
+			softRaster->remove(dead);
+		SDL_DestroyTexture(dead);
+	}
+	garbage.clear();
+
+	commands.clear();
+	vertexData.clear();
+	indexData.clear();
+	pointData.clear();
+	targets.clear();
+	order = 0;
+	current = State { nullptr, 0, false, SDL_Rect { 0, 0, 0, 0 } };
+}
+
+RenderQueue::Stats RenderQueue::execute()
+{
+	Stats stats { int(commands.size()), 0, 0, 0, 0 };
+
+	Image const frameTarget = SDL_GetRenderTarget(renderer);
+	Image target = frameTarget;
+	Image texture = nullptr;
+	bool clipped = false;
+	SDL_Rect clip { 0, 0, 0, 0 };
+	uint8_t blend = SDL_BLENDMODE_NONE;
+	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+	for(auto const & cmd : commands)
+	{
+		Image const cmdTarget = (cmd.target != nullptr) ? cmd.target : frameTarget;
+		if(cmdTarget != target)
+		{
+			// A new target starts without a clip rect
+			SDL_SetRenderTarget(renderer, cmdTarget);
+			target = cmdTarget;
+			clipped = false;
+			stats.targetSwitches++;
+		}
+		if(cmd.clipped != clipped || (clipped && !same_clip(cmd.clip, clip)))
+		{
+			SDL_RenderSetClipRect(renderer, cmd.clipped ? &cmd.clip : nullptr);
+			clipped = cmd.clipped;
+			clip = cmd.clip;
+			stats.clipSwitches++;
+		}
+		if(cmd.texture != nullptr && cmd.texture != texture)
+		{
+			texture = cmd.texture;
+			stats.textureSwitches++;
+		}
+		if(cmd.kind < Copy)
+		{
+			if(cmd.blend != blend)
+			{
+				SDL_SetRenderDrawBlendMode(renderer, SDL_BlendMode(cmd.blend));
+				blend = cmd.blend;
+			}
+			SDL_SetRenderDrawColor(renderer, cmd.color.r, cmd.color.g, cmd.color.b, cmd.color.a);
+		}
+
+		switch(cmd.kind)
+		{
+			case Clear:
+				SDL_RenderClear(renderer);
+				break;
+			case FillRect:
+				SDL_RenderFillRect(renderer, &cmd.dest);
+				break;
+			case Line:
+				SDL_RenderDrawLine(renderer, cmd.dest.x, cmd.dest.y, cmd.dest.w, cmd.dest.h);
+				break;
+			case Points:
+				SDL_RenderDrawPoints(renderer, pointData.data() + cmd.first, int(cmd.count));
+				break;
+			case Copy:
+				SDL_RenderCopy(renderer, cmd.texture, cmd.whole ? nullptr : &cmd.source, &cmd.dest);
+				break;
+			case Geometry:
+				SDL_RenderGeometry(
+					renderer,
+					cmd.texture,
+					vertexData.data() + cmd.first, int(cmd.count),
+					indexData.data() + cmd.firstIndex, int(cmd.indexCount));
+				break;
+		}
+		stats.drawCalls++;
+	}
+
+	if(target != frameTarget)
+		SDL_SetRenderTarget(renderer, frameTarget);
+	if(clipped)
+		SDL_RenderSetClipRect(renderer, nullptr);
+	if(blend != SDL_BLENDMODE_NONE)
+		SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+	return stats;
+}
+
+RenderQueue::Stats RenderQueue::rasterize()
+{
+	// Draw calls never reach SDL here, they count rasterized commands
+	Stats stats { int(commands.size()), int(commands.size()), 0, 0, 0 };
+
+	auto & raster = *softRaster;
+	raster.set_target(nullptr);
+	Image target = nullptr;
+	Image texture = nullptr;
+	bool clipped = false;
+	SDL_Rect clip { 0, 0, 0, 0 };
+
+	for(auto const & cmd : commands)
+	{
+		if(cmd.target != target)
+		{
+			raster.set_target(cmd.target);
+			target = cmd.target;
+			clipped = false;
+			stats.targetSwitches++;
+		}
+		if(cmd.clipped != clipped || (clipped && !same_clip(cmd.clip, clip)))
+		{
+			raster.set_clip(cmd.clipped ? &cmd.clip : nullptr);
+			clipped = cmd.clipped;
+			clip = cmd.clip;
+			stats.clipSwitches++;
+		}
+		if(cmd.texture != nullptr && cmd.texture != texture)
+		{
+			texture = cmd.texture;
+			stats.textureSwitches++;
+		}
+
+		switch(cmd.kind)
+		{
+			case Clear:
+				raster.clear(cmd.color);
+				break;
+			case FillRect:
+				raster.fill_rect(cmd.dest, cmd.color, SDL_BlendMode(cmd.blend));
+				break;
+			case Line:
+				raster.line(glm::ivec2(cmd.dest.x, cmd.dest.y), glm::ivec2(cmd.dest.w, cmd.dest.h), cmd.color);
+				break;
+			case Points:
+				raster.points(pointData.data() + cmd.first, cmd.count, cmd.color);
+				break;
+			case Copy:
+				raster.copy(cmd.texture, cmd.whole ? nullptr : &cmd.source, cmd.dest);
+				break;
+			case Geometry:
+				raster.geometry(cmd.texture, vertexData.data() + cmd.first, indexData.data() + cmd.firstIndex, cmd.indexCount);
+				break;
+		}
+	}
+	return stats;
+}
@@ -0,0 +1,138 @@
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+#include "engine.h"
+
+#include <vector>
+#include <cstdint>
+
+// Records the drawing of a frame and submits it in one pass. Commands are
+// stably sorted by render target, layer and texture before submission, so
+// only draws within the same layer may be reordered. Offscreen targets are
+// drawn first, in the order they were first used, the frame target last.
+class RenderQueue
+{
+public:
+	struct Stats
+	{
+		int commands;
+		int drawCalls;
+		int targetSwitches;
+		int textureSwitches;
+		int clipSwitches;
+	};
+
+	// Where commands are recorded to, see state() and restore()
+	struct State
+	{
+		Image target;
+		int layer;
+		bool clipped;
+		SDL_Rect clip;
+	};
+
+private:
+	enum Kind : uint8_t
+	{
+		Clear,
+		FillRect,
+		Line,
+		Points,
+		Copy,
+		Geometry
+	};
+
+	struct Command
+	{
+		Kind kind;
+		uint8_t blend;
+		bool clipped;
+		bool whole;
+		uint16_t pass;
+		uint32_t order;
+		int layer;
+		Image target;
+		Image texture;
+		SDL_Color color;
+		SDL_Rect clip;
+		SDL_Rect source;
+		SDL_Rect dest;
+		uint32_t first, count;
+		uint32_t firstIndex, indexCount;
+	};
+
+	State current;
+	uint32_t order;
+	std::vector<Image> targets;
+
+	std::vector<Command> commands;
+	std::vector<SDL_Vertex> vertexData;
+	std::vector<int> indexData;
+	std::vector<SDL_Point> pointData;
+	std::vector<Image> garbage;
+
+	Stats last;
+
+	Command & record(Kind kind, Image texture);
+
+	// Draw the sorted commands with SDL or with softRaster
+	Stats execute();
+	Stats rasterize();
+
+public:
+	RenderQueue();
+	RenderQueue(RenderQueue const &) = delete;
+
+	// nullptr is the target that is active when submit() is called.
+	// Switching the target resets the layer and the clip rect.
+	void set_target(Image target);
+	void set_layer(int layer);
+	void set_clip(SDL_Rect const * clip);
+
+	State state() const { return current; }
+	void restore(State const & state);
+
+	// Everything recorded after this is drawn after everything before it
+	// in the same layer, regardless of texture. Used for depth sorted sprites.
+	void order_barrier();
+
+	void clear(SDL_Color color);
+	void fill_rect(SDL_Rect const & rect, SDL_Color color, SDL_BlendMode blend = SDL_BLENDMODE_NONE);
+	void line(glm::ivec2 from, glm::ivec2 to, SDL_Color color);
+	void points(SDL_Point const * list, size_t count, SDL_Color color);
+
+	// source may be nullptr for the whole texture
+	void copy(Image texture, SDL_Rect const * source, SDL_Rect const & dest);
+	void geometry(Image texture, SDL_Vertex const * vertices, size_t vertexCount, int const * indices, size_t indexCount);
+
+	// Destroys the texture after the next submit, as commands may still use it
+	void destroy_later(Image texture);
+
+	// Sorts and draws everything recorded since the last submit. With
+	// softRaster set, the frame target is its frame instead.
+	void submit();
+
+	// Counters of the last submit
+	Stats const & stats() const { return last; }
+};
+
+extern RenderQueue renderQueue;
+
+// Records to target until destroyed, the queue version of RenderTargetGuard
+class QueueTargetGuard
+{
+private:
+	RenderQueue::State previous;
+public:
+	explicit QueueTargetGuard(Image target) : previous(renderQueue.state())
+	{
+		renderQueue.set_target(target);
+	}
+	QueueTargetGuard(QueueTargetGuard const &) = delete;
+	~QueueTargetGuard()
+	{
+		renderQueue.restore(previous);
+	}
+};
+
+#endif // RENDERQUEUE_HPP
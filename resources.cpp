@@ -0,0 +1,315 @@
+#include "resources.hpp"
+#include "softraster.hpp"
+
+#include <cstring>
+#include <cerrno>
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+static void destroy_texture(Image texture)
+{
+	if(softRaster != nullptr)
+		softRaster->remove(texture);
+	SDL_DestroyTexture(texture);
+}
+
+static bool has_suffix(std::string const & s, char const * suffix)
+{
+	auto const n = strlen(suffix);
+	return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+ResourceCache::ResourceCache() :
+	resources(), pack(), loader(), pages(),
+	watcher(), watching(false), reloadsMutex(), reloads()
+{
+}
+
+ResourceCache::~ResourceCache()
+{
+	// SDL may already be gone here, so only the thread is stopped
+	unwatch();
+}
+
+Resource & ResourceCache::get(Resource::Kind kind, char const * fileName, glm::ivec2 origin)
+{
+	auto & slot = resources[fileName];
+	if(slot != nullptr)
+	{
+		if(slot->kind != kind)
+			die("Resource requested as two different kinds");
+		return *slot;
+	}
+
+	slot.reset(new Resource { kind, fileName, origin, 0, Sprite(), nullptr, nullptr, nullptr });
+	if(kind == Resource::MusicFile)
+	{
+		slot->music = LoadMusic(fileName);
+		return *slot;
+	}
+
+	if(loader == nullptr)
+		loader.reset(new AssetLoader(pack.get()));
+	if(kind == Resource::ImageFile)
+		loader->add(slot->sprite, fileName, origin);
+	else
+		loader->add(slot->sound, fileName);
+	return *slot;
+}
+
+bool ResourceCache::open_pack(char const * fileName)
+{
+	struct stat info;
+	if(stat(fileName, &info) != 0)
+		return false;
+
+	pack.reset(new AssetPack(fileName));
+	auto const stale = pack->drop_older_than_files(info.st_mtime);
+	fprintf(stderr, "Using %lu baked assets from %s\n", (unsigned long)pack->size(), fileName);
+	if(stale > 0)
+		fprintf(stderr, "%lu assets changed since %s was baked, run baker/mlg-bake again\n", (unsigned long)stale, fileName);
+	return true;
+}
+
+Handle<Sprite> ResourceCache::sprite(char const * fileName, glm::ivec2 origin)
+{
+	return Handle<Sprite>(&get(Resource::ImageFile, fileName, origin));
+}
+
+Handle<Sound> ResourceCache::sound(char const * fileName)
+{
+	return Handle<Sound>(&get(Resource::SoundFile, fileName, glm::ivec2()));
+}
+
+Handle<Music> ResourceCache::music(char const * fileName)
+{
+	return Handle<Music>(&get(Resource::MusicFile, fileName, glm::ivec2()));
+}
+
+void ResourceCache::load(AssetLoader::Progress const & progress)
+{
+	if(loader == nullptr)
+		return;
+	auto loaded = loader->load(progress);
+	pages.insert(pages.end(), loaded.begin(), loaded.end());
+	loader.reset();
+}
+
+void ResourceCache::free(Resource & resource)
+{
+	// Freeing a chunk or music also stops it where it is playing
+	if(resource.texture != nullptr)
+		destroy_texture(resource.texture);
+	if(resource.sound != nullptr)
+		Mix_FreeChunk(resource.sound);
+	if(resource.music != nullptr)
+		Mix_FreeMusic(resource.music);
+	resource.texture = nullptr;
+	resource.sound = nullptr;
+	resource.music = nullptr;
+	resource.sprite = Sprite();
+}
+
+void ResourceCache::collect()
+{
+	// Pending loads still write into their resources
+	if(loader != nullptr)
+		return;
+
+	bool sprites = false;
+	for(auto it = resources.begin(); it != resources.end();)
+	{
+		auto & resource = *it->second;
+		if(resource.refs > 0)
+		{
+			sprites |= (resource.kind == Resource::ImageFile);
+			++it;
+			continue;
+		}
+		free(resource);
+		it = resources.erase(it);
+	}
+
+	// Atlas pages are shared, so they live as long as any sprite does
+	if(!sprites)
+	{
+		for(auto page : pages)
+			destroy_texture(page);
+		pages.clear();
+	}
+}
+
+void ResourceCache::watch(char const * directory)
+{
+	if(watching)
+		return;
+	watching = true;
+	watcher = std::thread(&ResourceCache::watch_loop, this, std::string(directory));
+}
+
+void ResourceCache::unwatch()
+{
+	watching = false;
+	if(watcher.joinable())
+		watcher.join();
+
+	for(auto & reload : reloads)
+	{
+		if(reload.surface != nullptr)
+			SDL_FreeSurface(reload.surface);
+		if(reload.sound != nullptr)
+			Mix_FreeChunk(reload.sound);
+	}
+	reloads.clear();
+}
+
+void ResourceCache::watch_loop(std::string directory)
+{
+#ifdef __linux__
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(fd < 0 || inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		fprintf(stderr, "Hot reload disabled: %s\n", strerror(errno));
+		if(fd >= 0)
+			close(fd);
+		return;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+	while(watching)
+	{
+		// Wake up regularly to notice unwatch()
+		pollfd p { fd, POLLIN, 0 };
+		if(poll(&p, 1, 100) <= 0)
+			continue;
+		auto const length = read(fd, buffer, sizeof buffer);
+		for(ssize_t i = 0; i < length;)
+		{
+			auto const * event = reinterpret_cast<inotify_event const *>(buffer + i);
+			i += ssize_t(sizeof(inotify_event) + event->len);
+			if(event->len == 0)
+				continue;
+
+			// Decoding happens here, the main thread only uploads
+			Reload reload { directory + "/" + event->name, nullptr, nullptr };
+			if(has_suffix(reload.fileName, ".png"))
+			{
+				auto * surface = IMG_Load(reload.fileName.c_str());
+				if(surface != nullptr)
+				{
+					reload.surface = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+					SDL_FreeSurface(surface);
+				}
+			}
+			else if(has_suffix(reload.fileName, ".wav"))
+			{
+				reload.sound = Mix_LoadWAV(reload.fileName.c_str());
+			}
+			else
+			{
+				continue;
+			}
+
+			if(reload.surface == nullptr && reload.sound == nullptr)
+			{
+				fprintf(stderr, "Could not reload %s\n", reload.fileName.c_str());
+				continue;
+			}
+
+			std::lock_guard<std::mutex> _l(reloadsMutex);
+			reloads.push_back(reload);
+		}
+	}
+	close(fd);
+#else
+	fprintf(stderr, "Hot reload is not supported on this platform, not watching %s\n", directory.c_str());
+#endif
+}
+
+static void reload_sprite(Resource & resource, SDL_Surface * surface)
+{
+	auto & sprite = resource.sprite;
+	glm::ivec2 const size(surface->w, surface->h);
+
+	if(size == sprite.size)
+	{
+		// Same size, overwrite the old pixels on the atlas page
+		Uint32 format;
+		SDL_QueryTexture(sprite.texture, &format, nullptr, nullptr, nullptr);
+		auto * converted = SDL_ConvertSurfaceFormat(surface, format, 0);
+		if(converted == nullptr)
+			return;
+		SDL_UpdateTexture(sprite.texture, &sprite.source, converted->pixels, converted->pitch);
+		if(softRaster != nullptr)
+			softRaster->update(sprite.texture, sprite.source, converted);
+		SDL_FreeSurface(converted);
+		return;
+	}
+
+	// Does not fit the atlas anymore, give it a texture of its own
+	auto * texture = SDL_CreateTextureFromSurface(renderer, surface);
+	if(texture == nullptr)
+		return;
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+	if(softRaster != nullptr)
+		softRaster->add_image(texture, surface);
+	if(resource.texture != nullptr)
+		destroy_texture(resource.texture);
+	resource.texture = texture;
+
+	sprite.texture = texture;
+	sprite.source = SDL_Rect { 0, 0, size.x, size.y };
+	sprite.size = size;
+	sprite.uv0 = glm::vec2(0, 0);
+	sprite.uv1 = glm::vec2(1, 1);
+}
+
+bool ResourceCache::apply_reloads()
+{
+	std::vector<Reload> batch;
+	{
+		std::lock_guard<std::mutex> _l(reloadsMutex);
+		if(reloads.empty())
+			return false;
+		batch.swap(reloads);
+	}
+
+	bool changed = false;
+	for(auto & reload : batch)
+	{
+		auto it = resources.find(reload.fileName);
+		auto * resource = (it != resources.end()) ? it->second.get() : nullptr;
+
+		if(reload.surface != nullptr)
+		{
+			if(resource != nullptr && resource->kind == Resource::ImageFile && resource->sprite.texture != nullptr)
+			{
+				reload_sprite(*resource, reload.surface);
+				fprintf(stderr, "Reloaded %s\n", reload.fileName.c_str());
+				changed = true;
+			}
+			SDL_FreeSurface(reload.surface);
+		}
+		else
+		{
+			// Voices refer to the chunk by address, so the new samples are
+			// swapped into the old chunk where sounds are started
+			if(resource != nullptr && resource->kind == Resource::SoundFile && resource->sound != nullptr)
+			{
+				ReplaceSound(resource->sound, reload.sound);
+				fprintf(stderr, "Reloaded %s\n", reload.fileName.c_str());
+			}
+			else
+			{
+				Mix_FreeChunk(reload.sound);
+			}
+		}
+	}
+	return changed;
+}
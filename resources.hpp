@@ -0,0 +1,151 @@
+#ifndef RESOURCES_HPP
+#define RESOURCES_HPP
+
+#include "engine.h"
+#include "atlas.hpp"
+#include "assetloader.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <utility>
+
+// A file loaded once and shared by every handle to it. A hot reload
+// replaces the contents in place, so all handles see the new data.
+struct Resource
+{
+	enum Kind { ImageFile, SoundFile, MusicFile };
+
+	Kind kind;
+	std::string fileName;
+	glm::ivec2 origin;
+	int refs;
+
+	Sprite sprite;
+	Sound sound;
+	Music music;
+
+	// Set when a reload changed the image size and it left its atlas page
+	Image texture;
+};
+
+template<typename T> T const & resource_value(Resource const & r);
+template<> inline Sprite const & resource_value<Sprite>(Resource const & r) { return r.sprite; }
+template<> inline Sound const & resource_value<Sound>(Resource const & r) { return r.sound; }
+template<> inline Music const & resource_value<Music>(Resource const & r) { return r.music; }
+
+// Counted reference to a cached resource. Handles are only copied and
+// dropped on the main thread, so the count is not atomic. The simulation
+// thread dereferences them too, but may only read what reloads leave
+// alone: sounds go through ReplaceSound() and sprite sizes are copied.
+template<typename T>
+class Handle
+{
+private:
+	Resource * resource;
+
+public:
+	Handle() : resource(nullptr)
+	{
+	}
+
+	explicit Handle(Resource * resource) : resource(resource)
+	{
+		if(resource != nullptr)
+			resource->refs++;
+	}
+
+	Handle(Handle const & other) : Handle(other.resource)
+	{
+	}
+
+	Handle(Handle && other) : resource(other.resource)
+	{
+		other.resource = nullptr;
+	}
+
+	~Handle()
+	{
+		reset();
+	}
+
+	Handle & operator=(Handle other)
+	{
+		std::swap(resource, other.resource);
+		return *this;
+	}
+
+	void reset()
+	{
+		if(resource != nullptr)
+			resource->refs--;
+		resource = nullptr;
+	}
+
+	explicit operator bool() const { return resource != nullptr; }
+
+	T const & operator*() const { return resource_value<T>(*resource); }
+	T const * operator->() const { return &resource_value<T>(*resource); }
+};
+
+// Owns all file backed assets. Requests for the same file share one
+// resource; images and sounds are decoded in a batch by load(), music
+// is loaded right away. Everything without handles is freed by collect().
+class ResourceCache
+{
+private:
+	struct Reload
+	{
+		std::string fileName;
+		SDL_Surface * surface;
+		Sound sound;
+	};
+
+	std::unordered_map<std::string, std::unique_ptr<Resource>> resources;
+	std::unique_ptr<AssetPack> pack;
+	std::unique_ptr<AssetLoader> loader;
+	std::vector<Image> pages;
+
+	std::thread watcher;
+	std::atomic<bool> watching;
+	std::mutex reloadsMutex;
+	std::vector<Reload> reloads;
+
+	Resource & get(Resource::Kind kind, char const * fileName, glm::ivec2 origin);
+	void watch_loop(std::string directory);
+	void free(Resource & resource);
+
+public:
+	ResourceCache();
+	ResourceCache(ResourceCache const &) = delete;
+	~ResourceCache();
+
+	// Loads later requests from a pack made by the bake tool if it
+	// exists. Files missing from it or newer than it still come from disk.
+	bool open_pack(char const * fileName);
+
+	Handle<Sprite> sprite(char const * fileName, glm::ivec2 origin = glm::ivec2());
+	Handle<Sound> sound(char const * fileName);
+	Handle<Music> music(char const * fileName);
+
+	// Decodes all sprites and sounds requested since the last call
+	void load(AssetLoader::Progress const & progress);
+
+	// Frees everything no handle refers to anymore. Atlas pages are only
+	// freed together with the last sprite.
+	void collect();
+
+	// Starts reloading changed images and sounds in directory. Files are
+	// decoded on a background thread, apply_reloads() swaps them in.
+	void watch(char const * directory);
+	void unwatch();
+
+	// Returns true if a sprite changed
+	bool apply_reloads();
+};
+
+#endif // RESOURCES_HPP
@@ -0,0 +1,276 @@
+#include "savegame.hpp"
+#include "mappedfile.hpp"
+
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <cstdio>
+#else
+#include <unistd.h>
+#endif
+
+static uint32_t const savegame_version = 2;
+static uint32_t const legacy_magic = 0xBADEAFFE;
+static char const savegame_magic[8] = { 'M', 'L', 'G', 'S', 'A', 'V', 'E', '\0' };
+
+static uint32_t const tag_plants = 0x544E4C50; // "PLNT"
+
+static size_t const header_size = 40;
+static size_t const section_header_size = 20;
+static size_t const plant_record_size = 28;
+static size_t const plant_chunk_size = 65536;
+
+// Size of the in-memory Plant struct the legacy format dumped
+static size_t const legacy_plant_size = 32;
+
+static uint32_t crc32(uint8_t const * data, size_t length)
+{
+	static uint32_t table[256];
+	static bool initialized = false;
+	if(!initialized)
+	{
+		for(uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+			for(int k = 0; k < 8; k++)
+				c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+			table[i] = c;
+		}
+		initialized = true;
+	}
+
+	uint32_t crc = 0xFFFFFFFF;
+	for(size_t i = 0; i < length; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFF;
+}
+
+static void put_u32(uint8_t * p, uint32_t v)
+{
+	p[0] = uint8_t(v);
+	p[1] = uint8_t(v >> 8);
+	p[2] = uint8_t(v >> 16);
+	p[3] = uint8_t(v >> 24);
+}
+
+static void put_u64(uint8_t * p, uint64_t v)
+{
+	put_u32(p, uint32_t(v));
+	put_u32(p + 4, uint32_t(v >> 32));
+}
+
+static void put_f64(uint8_t * p, double v)
+{
+	uint64_t bits;
+	memcpy(&bits, &v, sizeof bits);
+	put_u64(p, bits);
+}
+
+static uint32_t get_u32(uint8_t const * p)
+{
+	return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static uint64_t get_u64(uint8_t const * p)
+{
+	return uint64_t(get_u32(p)) | (uint64_t(get_u32(p + 4)) << 32);
+}
+
+static double get_f64(uint8_t const * p)
+{
+	uint64_t bits = get_u64(p);
+	double v;
+	memcpy(&v, &bits, sizeof v);
+	return v;
+}
+
+bool HasSavegame(char const * fileName)
+{
+	FILE * f = fopen(fileName, "rb");
+	if(f != nullptr)
+		fclose(f);
+	return (f != nullptr);
+}
+
+bool TryWriteSavegame(char const * fileName, int32_t money, std::vector<Plant> const & plants, std::string & error)
+{
+	// Write to a temporary file first, so a crash while saving
+	// never leaves a half written savegame behind.
+	std::string const tempName = std::string(fileName) + ".tmp";
+	FILE * f = fopen(tempName.c_str(), "wb");
+	if(f == nullptr)
+	{
+		error = "Could not open " + tempName;
+		return false;
+	}
+	bool written = true;
+
+	size_t const sections = (plants.size() + plant_chunk_size - 1) / plant_chunk_size;
+
+	uint8_t header[header_size] = { };
+	memcpy(header, savegame_magic, sizeof savegame_magic);
+	put_u32(header + 8, savegame_version);
+	put_u32(header + 12, uint32_t(header_size));
+	put_u32(header + 16, uint32_t(money));
+	put_u32(header + 20, uint32_t(sections));
+	put_u64(header + 24, plants.size());
+	put_u32(header + 32, crc32(header, 32));
+	written &= (fwrite(header, header_size, 1, f) == 1);
+
+	std::vector<uint8_t> chunk;
+	chunk.reserve(plant_chunk_size * plant_record_size);
+	for(size_t start = 0; written && start < plants.size(); start += plant_chunk_size)
+	{
+		size_t const count = std::min(plant_chunk_size, plants.size() - start);
+
+		chunk.resize(count * plant_record_size);
+		uint8_t * p = chunk.data();
+		for(size_t i = 0; i < count; i++, p += plant_record_size)
+		{
+			auto const & plant = plants[start + i];
+			put_u32(p + 0, uint32_t(plant._type));
+			put_u32(p + 4, uint32_t(plant.position.x));
+			put_u32(p + 8, uint32_t(plant.position.y));
+			put_f64(p + 12, plant.growth);
+			put_f64(p + 20, plant.watering);
+		}
+
+		uint8_t section[section_header_size];
+		put_u32(section + 0, tag_plants);
+		put_u32(section + 4, uint32_t(plant_record_size));
+		put_u64(section + 8, count);
+		put_u32(section + 16, crc32(chunk.data(), chunk.size()));
+		written &= (fwrite(section, section_header_size, 1, f) == 1);
+		written &= (fwrite(chunk.data(), chunk.size(), 1, f) == 1);
+	}
+
+	// Only a file that is completely on disk may replace the old one
+	written &= (fflush(f) == 0);
+#ifndef _WIN32
+	written &= (fsync(fileno(f)) == 0);
+#endif
+	written &= (fclose(f) == 0);
+	if(!written)
+	{
+		error = "Could not write " + tempName + ": " + strerror(errno);
+		remove(tempName.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	remove(fileName);
+#endif
+	if(rename(tempName.c_str(), fileName) != 0)
+	{
+		error = "Could not replace " + std::string(fileName) + ": " + strerror(errno);
+		remove(tempName.c_str());
+		return false;
+	}
+	return true;
+}
+
+void WriteSavegame(char const * fileName, int32_t money, std::vector<Plant> const & plants)
+{
+	std::string error;
+	if(!TryWriteSavegame(fileName, money, plants, error))
+		die(error.c_str());
+}
+
+static void read_legacy(MappedFile const & file, int32_t & money, std::vector<Plant> & plants)
+{
+	auto const * p = file.data();
+	if(file.size() < 12)
+		die("Failed to load game: Truncated savegame!");
+
+	money = int32_t(get_u32(p + 4));
+	uint32_t const count = get_u32(p + 8);
+	if(file.size() < 12 + size_t(count) * legacy_plant_size)
+		die("Failed to load game: Truncated savegame!");
+
+	plants.resize(count);
+	p += 12;
+	for(auto & plant : plants)
+	{
+		// int _type, ivec2 position, 4 bytes padding, double growth, double watering
+		plant._type = int32_t(get_u32(p + 0));
+		plant.position = glm::ivec2(int32_t(get_u32(p + 4)), int32_t(get_u32(p + 8)));
+		plant.growth = get_f64(p + 16);
+		plant.watering = get_f64(p + 24);
+		p += legacy_plant_size;
+	}
+}
+
+void ReadSavegame(char const * fileName, int32_t & money, std::vector<Plant> & plants)
+{
+	MappedFile file(fileName);
+	auto const * data = file.data();
+	auto const size = file.size();
+
+	plants.clear();
+
+	if(size >= 4 && get_u32(data) == legacy_magic)
+	{
+		read_legacy(file, money, plants);
+		return;
+	}
+
+	if(size < header_size || memcmp(data, savegame_magic, sizeof savegame_magic) != 0)
+		die("Failed to load game: Not a savegame!");
+	if(get_u32(data + 32) != crc32(data, 32))
+		die("Failed to load game: Header checksum mismatch!");
+	if(get_u32(data + 8) > savegame_version)
+		die("Failed to load game: Savegame is from a newer version!");
+
+	size_t offset = get_u32(data + 12);
+	money = int32_t(get_u32(data + 16));
+	uint32_t const sections = get_u32(data + 20);
+	uint64_t const total = get_u64(data + 24);
+
+	// Never trust the header with the allocation size
+	if(total > size / plant_record_size)
+		die("Failed to load game: Truncated savegame!");
+	plants.resize(size_t(total));
+
+	size_t loaded = 0;
+	for(uint32_t s = 0; s < sections; s++)
+	{
+		if(offset + section_header_size > size)
+			die("Failed to load game: Truncated savegame!");
+		auto const * section = data + offset;
+		uint32_t const tag = get_u32(section + 0);
+		uint32_t const recordSize = get_u32(section + 4);
+		uint64_t const count = get_u64(section + 8);
+		uint32_t const checksum = get_u32(section + 16);
+
+		// Checked before multiplying, a corrupt count must not wrap around
+		offset += section_header_size;
+		if(recordSize == 0 || count > (size - offset) / recordSize)
+			die("Failed to load game: Truncated savegame!");
+		size_t const length = size_t(count) * recordSize;
+		auto const * p = data + offset;
+		offset += length;
+
+		if(tag != tag_plants)
+			continue;
+		if(recordSize < plant_record_size || count > total - loaded)
+			die("Failed to load game: Invalid plant section!");
+		if(crc32(p, length) != checksum)
+			die("Failed to load game: Plant section checksum mismatch!");
+
+		Plant * out = plants.data() + loaded;
+		for(size_t i = 0; i < count; i++, p += recordSize)
+		{
+			out[i]._type = int32_t(get_u32(p + 0));
+			out[i].position = glm::ivec2(int32_t(get_u32(p + 4)), int32_t(get_u32(p + 8)));
+			out[i].growth = get_f64(p + 12);
+			out[i].watering = get_f64(p + 20);
+		}
+		loaded += count;
+	}
+
+	if(loaded != total)
+		die("Failed to load game: Missing plant sections!");
+}
@@ -0,0 +1,33 @@
+#ifndef SAVEGAME_HPP
+#define SAVEGAME_HPP
+
+#include "plant.hpp"
+
+#include <vector>
+#include <string>
+
+// Savegame layout, all values little endian:
+//
+//   header   magic "MLGSAVE\0", u32 version, u32 header size,
+//            i32 money, u32 section count, u64 plant count,
+//            u32 header checksum
+//   section  u32 tag, u32 record size, u64 record count,
+//            u32 payload checksum, payload
+//
+// Plants are stored in "PLNT" sections of at most plant_chunk_size
+// records with the fields i32 type, i32 x, i32 y, f64 growth,
+// f64 watering. Unknown section tags are skipped. Checksums are CRC32.
+
+bool HasSavegame(char const * fileName);
+
+void WriteSavegame(char const * fileName, int32_t money, std::vector<Plant> const & plants);
+
+// Like WriteSavegame(), but reports errors instead of dying and leaves
+// the old savegame untouched then. For saves off the main thread.
+bool TryWriteSavegame(char const * fileName, int32_t money, std::vector<Plant> const & plants, std::string & error);
+
+// Replaces plants with the saved ones, also reads the legacy
+// 0xBADEAFFE format. Dies on corrupt files.
+void ReadSavegame(char const * fileName, int32_t & money, std::vector<Plant> & plants);
+
+#endif // SAVEGAME_HPP
@@ -0,0 +1,369 @@
+#include "softraster.hpp"
+#include "palette.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define RASTER_SSE2
+#include <emmintrin.h>
+#endif
+
+SoftRaster * softRaster = nullptr;
+
+uint8_t const SoftRaster::transparent;
+
+// In PICO-8 order, so the indices match the ones of the original palette
+static SDL_Color const colors[16] = {
+	{ BLACK, 0xFF }, { DARK_BLUE, 0xFF }, { DARK_PURPLE, 0xFF }, { DARK_GREEN, 0xFF },
+	{ BROWN, 0xFF }, { DARK_GRAY, 0xFF }, { LIGHT_GRAY, 0xFF }, { WHITE, 0xFF },
+	{ RED, 0xFF }, { ORANGE, 0xFF }, { YELLOW, 0xFF }, { GREEN, 0xFF },
+	{ BLUE, 0xFF }, { INDIGO, 0xFF }, { PINK, 0xFF }, { PEACH, 0xFF },
+};
+
+static SDL_Rect intersect(SDL_Rect const & a, SDL_Rect const & b)
+{
+	int const x0 = std::max(a.x, b.x);
+	int const y0 = std::max(a.y, b.y);
+	int const x1 = std::min(a.x + a.w, b.x + b.w);
+	int const y1 = std::min(a.y + a.h, b.y + b.h);
+	return SDL_Rect { x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0) };
+}
+
+// Copies n pixels, leaving the destination where the source is transparent
+static void copy_keyed(uint8_t * dst, uint8_t const * src, int n)
+{
+	int i = 0;
+#ifdef RASTER_SSE2
+	__m128i const key = _mm_set1_epi8(char(SoftRaster::transparent));
+	for(; i + 16 <= n; i += 16)
+	{
+		__m128i const s = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i));
+		__m128i const d = _mm_loadu_si128(reinterpret_cast<__m128i const *>(dst + i));
+		__m128i const hole = _mm_cmpeq_epi8(s, key);
+		_mm_storeu_si128(
+			reinterpret_cast<__m128i *>(dst + i),
+			_mm_or_si128(_mm_and_si128(hole, d), _mm_andnot_si128(hole, s)));
+	}
+#endif
+	for(; i < n; i++)
+	{
+		if(src[i] != SoftRaster::transparent)
+			dst[i] = src[i];
+	}
+}
+
+SoftRaster::SoftRaster(int w, int h) :
+	images(), frame(IndexedImage { w, h, std::vector<uint8_t>(size_t(w * h), 0) }),
+	frameTexture(nullptr), palette(), nearest(),
+	target(&frame), clip(SDL_Rect { 0, 0, w, h })
+{
+	frameTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, w, h);
+	if(frameTexture == nullptr)
+		die(SDL_GetError());
+
+	// Unused and transparent indices show up black
+	for(auto & entry : palette)
+		entry = 0xFF000000;
+	for(int i = 0; i < 16; i++)
+		palette[i] = 0xFF000000 | (uint32_t(colors[i].r) << 16) | (uint32_t(colors[i].g) << 8) | colors[i].b;
+}
+
+SoftRaster::~SoftRaster()
+{
+	SDL_DestroyTexture(frameTexture);
+}
+
+uint8_t SoftRaster::index_of(SDL_Color color)
+{
+	if(color.a < 0x80)
+		return transparent;
+
+	uint32_t const key = (uint32_t(color.r) << 16) | (uint32_t(color.g) << 8) | color.b;
+	auto it = nearest.find(key);
+	if(it != nearest.end())
+		return it->second;
+
+	uint8_t best = 0;
+	int bestDistance = 0x7FFFFFFF;
+	for(int i = 0; i < 16; i++)
+	{
+		int const dr = int(color.r) - colors[i].r;
+		int const dg = int(color.g) - colors[i].g;
+		int const db = int(color.b) - colors[i].b;
+		int const distance = dr * dr + dg * dg + db * db;
+		if(distance < bestDistance)
+		{
+			best = uint8_t(i);
+			bestDistance = distance;
+		}
+	}
+	nearest.emplace(key, best);
+	return best;
+}
+
+void SoftRaster::convert(SDL_Surface * surface, IndexedImage & image, int x, int y)
+{
+	auto * argb = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+	if(argb == nullptr)
+		die(SDL_GetError());
+
+	SDL_Rect const area = intersect(SDL_Rect { x, y, argb->w, argb->h }, SDL_Rect { 0, 0, image.w, image.h });
+	SDL_LockSurface(argb);
+	for(int py = area.y; py < area.y + area.h; py++)
+	{
+		auto const * row = reinterpret_cast<uint32_t const *>(static_cast<uint8_t const *>(argb->pixels) + (py - y) * argb->pitch);
+		auto * out = image.pixels.data() + py * image.w;
+		for(int px = area.x; px < area.x + area.w; px++)
+		{
+			uint32_t const c = row[px - x];
+			out[px] = index_of(SDL_Color { Uint8(c >> 16), Uint8(c >> 8), Uint8(c), Uint8(c >> 24) });
+		}
+	}
+	SDL_UnlockSurface(argb);
+	SDL_FreeSurface(argb);
+}
+
+void SoftRaster::add_image(Image texture, SDL_Surface * surface)
+{
+	auto & image = images[texture];
+	image = IndexedImage { surface->w, surface->h, std::vector<uint8_t>(size_t(surface->w * surface->h), transparent) };
+	convert(surface, image, 0, 0);
+}
+
+void SoftRaster::add_target(Image texture, int w, int h)
+{
+	images[texture] = IndexedImage { w, h, std::vector<uint8_t>(size_t(w * h), transparent) };
+}
+
+void SoftRaster::update(Image texture, SDL_Rect const & rect, SDL_Surface * surface)
+{
+	auto it = images.find(texture);
+	if(it == images.end())
+		return;
+	convert(surface, it->second, rect.x, rect.y);
+}
+
+void SoftRaster::remove(Image texture)
+{
+	if(target != &frame && target == image(texture))
+		set_target(nullptr);
+	images.erase(texture);
+}
+
+SoftRaster::IndexedImage const * SoftRaster::image(Image texture) const
+{
+	auto it = images.find(texture);
+	return (it != images.end()) ? &it->second : nullptr;
+}
+
+void SoftRaster::set_target(Image texture)
+{
+	if(texture == nullptr)
+	{
+		target = &frame;
+	}
+	else
+	{
+		auto it = images.find(texture);
+		if(it == images.end())
+			die("Render target is not known to the software rasterizer");
+		target = &it->second;
+	}
+	set_clip(nullptr);
+}
+
+void SoftRaster::set_clip(SDL_Rect const * rect)
+{
+	SDL_Rect const whole { 0, 0, target->w, target->h };
+	clip = (rect != nullptr) ? intersect(*rect, whole) : whole;
+}
+
+void SoftRaster::plot(int x, int y, uint8_t index)
+{
+	if(x < clip.x || y < clip.y || x >= clip.x + clip.w || y >= clip.y + clip.h)
+		return;
+	target->pixels[size_t(y * target->w + x)] = index;
+}
+
+void SoftRaster::clear(SDL_Color color)
+{
+	// Like SDL_RenderClear, this ignores the clip rect
+	std::fill(target->pixels.begin(), target->pixels.end(), index_of(color));
+}
+
+void SoftRaster::fill_rect(SDL_Rect const & rect, SDL_Color color, SDL_BlendMode blend)
+{
+	SDL_Rect const area = intersect(rect, clip);
+	if(area.w == 0 || area.h == 0)
+		return;
+
+	if(blend == SDL_BLENDMODE_NONE || color.a == 0xFF)
+	{
+		uint8_t const index = index_of(color);
+		for(int y = area.y; y < area.y + area.h; y++)
+			memset(target->pixels.data() + y * target->w + area.x, index, size_t(area.w));
+		return;
+	}
+
+	// Each of the 16 colours blends to another palette colour
+	uint8_t table[256];
+	for(int i = 0; i < 256; i++)
+	{
+		SDL_Color under { 0, 0, 0, 0xFF };
+		if(i < 16)
+			under = colors[i];
+		auto const mix = [&](Uint8 a, Uint8 b) { return Uint8((a * (255 - color.a) + b * color.a) / 255); };
+		table[i] = index_of(SDL_Color { mix(under.r, color.r), mix(under.g, color.g), mix(under.b, color.b), 0xFF });
+	}
+	for(int y = area.y; y < area.y + area.h; y++)
+	{
+		auto * row = target->pixels.data() + y * target->w;
+		for(int x = area.x; x < area.x + area.w; x++)
+			row[x] = table[row[x]];
+	}
+}
+
+void SoftRaster::line(glm::ivec2 from, glm::ivec2 to, SDL_Color color)
+{
+	uint8_t const index = index_of(color);
+	if(index == transparent)
+		return;
+
+	// Bresenham, both end points included like SDL_RenderDrawLine
+	glm::ivec2 const d(std::abs(to.x - from.x), -std::abs(to.y - from.y));
+	glm::ivec2 const step(from.x < to.x ? 1 : -1, from.y < to.y ? 1 : -1);
+	int error = d.x + d.y;
+	while(true)
+	{
+		plot(from.x, from.y, index);
+		if(from == to)
+			break;
+		int const e2 = 2 * error;
+		if(e2 >= d.y)
+		{
+			error += d.y;
+			from.x += step.x;
+		}
+		if(e2 <= d.x)
+		{
+			error += d.x;
+			from.y += step.y;
+		}
+	}
+}
+
+void SoftRaster::points(SDL_Point const * list, size_t count, SDL_Color color)
+{
+	uint8_t const index = index_of(color);
+	if(index == transparent)
+		return;
+	for(size_t i = 0; i < count; i++)
+		plot(list[i].x, list[i].y, index);
+}
+
+void SoftRaster::blit(IndexedImage const & image, bool keyed, SDL_Rect source, SDL_Rect dest)
+{
+	if(source.w <= 0 || source.h <= 0)
+		return;
+
+	SDL_Rect const area = intersect(dest, clip);
+	if(area.w == 0 || area.h == 0)
+		return;
+
+	if(source.w == dest.w && source.h == dest.h)
+	{
+		// Unscaled, whole rows at a time
+		SDL_Rect const inside = intersect(
+			SDL_Rect { area.x - dest.x + source.x, area.y - dest.y + source.y, area.w, area.h },
+			SDL_Rect { 0, 0, image.w, image.h });
+		glm::ivec2 const to(inside.x - source.x + dest.x, inside.y - source.y + dest.y);
+		for(int y = 0; y < inside.h; y++)
+		{
+			auto const * src = image.pixels.data() + (inside.y + y) * image.w + inside.x;
+			auto * dst = target->pixels.data() + (to.y + y) * target->w + to.x;
+			if(keyed)
+				copy_keyed(dst, src, inside.w);
+			else
+				memcpy(dst, src, size_t(inside.w));
+		}
+		return;
+	}
+
+	// Scaled, nearest neighbour
+	for(int y = area.y; y < area.y + area.h; y++)
+	{
+		int const sy = std::min(image.h - 1, source.y + (y - dest.y) * source.h / dest.h);
+		if(sy < 0)
+			continue;
+		auto * dst = target->pixels.data() + y * target->w;
+		for(int x = area.x; x < area.x + area.w; x++)
+		{
+			int const sx = std::min(image.w - 1, source.x + (x - dest.x) * source.w / dest.w);
+			if(sx < 0)
+				continue;
+			uint8_t const index = image.pixels[size_t(sy * image.w + sx)];
+			if(!keyed || index != transparent)
+				dst[x] = index;
+		}
+	}
+}
+
+void SoftRaster::copy(Image texture, SDL_Rect const * source, SDL_Rect const & dest)
+{
+	auto const * img = image(texture);
+	if(img == nullptr)
+		die("Texture is not known to the software rasterizer");
+
+	SDL_BlendMode mode;
+	SDL_GetTextureBlendMode(texture, &mode);
+	SDL_Rect const whole { 0, 0, img->w, img->h };
+	blit(*img, mode != SDL_BLENDMODE_NONE, (source != nullptr) ? *source : whole, dest);
+}
+
+void SoftRaster::geometry(Image texture, SDL_Vertex const * vertices, int const * indices, size_t indexCount)
+{
+	auto const * img = image(texture);
+	if(img == nullptr)
+		die("Texture is not known to the software rasterizer");
+
+	SDL_BlendMode mode;
+	SDL_GetTextureBlendMode(texture, &mode);
+
+	// The first and third corner of each quad are opposite each other
+	for(size_t i = 0; i + 6 <= indexCount; i += 6)
+	{
+		auto const & a = vertices[indices[i]];
+		auto const & b = vertices[indices[i + 2]];
+		auto const round = [](float f) { return int(f + 0.5f); };
+
+		SDL_Rect const dest {
+			round(a.position.x), round(a.position.y),
+			round(b.position.x) - round(a.position.x), round(b.position.y) - round(a.position.y)
+		};
+		SDL_Rect const source {
+			round(a.tex_coord.x * img->w), round(a.tex_coord.y * img->h),
+			round(b.tex_coord.x * img->w) - round(a.tex_coord.x * img->w),
+			round(b.tex_coord.y * img->h) - round(a.tex_coord.y * img->h)
+		};
+		blit(*img, mode != SDL_BLENDMODE_NONE, source, dest);
+	}
+}
+
+Image SoftRaster::present()
+{
+	void * pixels;
+	int pitch;
+	if(SDL_LockTexture(frameTexture, nullptr, &pixels, &pitch) < 0)
+		die(SDL_GetError());
+	for(int y = 0; y < frame.h; y++)
+	{
+		auto const * src = frame.pixels.data() + y * frame.w;
+		auto * dst = reinterpret_cast<uint32_t *>(static_cast<uint8_t *>(pixels) + y * pitch);
+		for(int x = 0; x < frame.w; x++)
+			dst[x] = palette[src[x]];
+	}
+	SDL_UnlockTexture(frameTexture);
+	return frameTexture;
+}
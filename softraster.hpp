@@ -0,0 +1,86 @@
+#ifndef SOFTRASTER_HPP
+#define SOFTRASTER_HPP
+
+#include "engine.h"
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Draws into 8-bit images indexed into the 16 colour palette of palette.h
+// instead of SDL render targets. Every texture the game draws from or to
+// has an indexed copy here, registered when it is created. The frame is
+// converted to 32 bit once and uploaded to a single streaming texture, so
+// the renderer needs neither target textures nor more than one copy.
+class SoftRaster
+{
+public:
+	// Palette index of transparent pixels
+	static uint8_t const transparent = 0xFF;
+
+	struct IndexedImage
+	{
+		int w, h;
+		std::vector<uint8_t> pixels;
+	};
+
+private:
+	std::unordered_map<Image, IndexedImage> images;
+	IndexedImage frame;
+	Image frameTexture;
+
+	uint32_t palette[256];
+	std::unordered_map<uint32_t, uint8_t> nearest;
+
+	IndexedImage * target;
+	SDL_Rect clip;
+
+	void convert(SDL_Surface * surface, IndexedImage & image, int x, int y);
+	void plot(int x, int y, uint8_t index);
+	void blit(IndexedImage const & image, bool keyed, SDL_Rect source, SDL_Rect dest);
+
+public:
+	// w and h are the size of the frame
+	SoftRaster(int w, int h);
+	SoftRaster(SoftRaster const &) = delete;
+	~SoftRaster();
+
+	// Palette index closest to color, transparent for mostly transparent colors
+	uint8_t index_of(SDL_Color color);
+
+	// Copies the pixels of surface for texture, called whenever one is created
+	void add_image(Image texture, SDL_Surface * surface);
+
+	// Creates an empty image for a texture that is drawn to
+	void add_target(Image texture, int w, int h);
+
+	// Overwrites rect of the image of texture with surface
+	void update(Image texture, SDL_Rect const & rect, SDL_Surface * surface);
+
+	void remove(Image texture);
+
+	IndexedImage const * image(Image texture) const;
+
+	// nullptr is the frame. Switching the target resets the clip rect.
+	void set_target(Image texture);
+	void set_clip(SDL_Rect const * rect);
+
+	void clear(SDL_Color color);
+	void fill_rect(SDL_Rect const & rect, SDL_Color color, SDL_BlendMode blend);
+	void line(glm::ivec2 from, glm::ivec2 to, SDL_Color color);
+	void points(SDL_Point const * list, size_t count, SDL_Color color);
+
+	// Unscaled copies take a fast path, everything else is sampled
+	void copy(Image texture, SDL_Rect const * source, SDL_Rect const & dest);
+
+	// Only axis aligned quads as SpriteBatch builds them are supported
+	void geometry(Image texture, SDL_Vertex const * vertices, int const * indices, size_t indexCount);
+
+	// Converts the frame to 32 bit, uploads it and returns the texture
+	Image present();
+};
+
+// nullptr unless the game renders in software, see RenderQueue::submit()
+extern SoftRaster * softRaster;
+
+#endif // SOFTRASTER_HPP
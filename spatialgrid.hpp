@@ -0,0 +1,133 @@
+#ifndef SPATIALGRID_HPP
+#define SPATIALGRID_HPP
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <limits>
+
+// Bucketed uniform grid over integer positions. Every entry is an id
+// (usually an index into some external storage) tagged with its position,
+// so nearest-neighbour queries never have to touch the external storage.
+class SpatialGrid
+{
+public:
+	static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+private:
+	struct Entry
+	{
+		uint32_t id;
+		glm::ivec2 position;
+	};
+
+	int cellSize;
+	std::unordered_map<uint64_t, std::vector<Entry>> cells;
+
+	glm::ivec2 cell_of(glm::ivec2 pos) const
+	{
+		// floor division, positions may become negative
+		return glm::ivec2(
+			(pos.x >= 0 ? pos.x : pos.x - cellSize + 1) / cellSize,
+			(pos.y >= 0 ? pos.y : pos.y - cellSize + 1) / cellSize);
+	}
+
+	static uint64_t key_of(glm::ivec2 cell)
+	{
+		return (uint64_t(uint32_t(cell.x)) << 32) | uint64_t(uint32_t(cell.y));
+	}
+
+	std::vector<Entry> * bucket(glm::ivec2 pos)
+	{
+		auto it = cells.find(key_of(cell_of(pos)));
+		if(it == cells.end())
+			return nullptr;
+		return &it->second;
+	}
+
+public:
+	explicit SpatialGrid(int cellSize = 8) : cellSize(cellSize), cells()
+	{
+	}
+
+	void clear()
+	{
+		cells.clear();
+	}
+
+	void insert(uint32_t id, glm::ivec2 pos)
+	{
+		cells[key_of(cell_of(pos))].push_back(Entry { id, pos });
+	}
+
+	void remove(uint32_t id, glm::ivec2 pos)
+	{
+		auto * list = bucket(pos);
+		if(list == nullptr)
+			return;
+		for(auto & e : *list)
+		{
+			if(e.id != id)
+				continue;
+			e = list->back();
+			list->pop_back();
+			break;
+		}
+		if(list->empty())
+			cells.erase(key_of(cell_of(pos)));
+	}
+
+	// Renames an entry, used when the external storage moves an element.
+	void renumber(uint32_t from, uint32_t to, glm::ivec2 pos)
+	{
+		auto * list = bucket(pos);
+		if(list == nullptr)
+			return;
+		for(auto & e : *list)
+		{
+			if(e.id == from)
+			{
+				e.id = to;
+				return;
+			}
+		}
+	}
+
+	// Returns the id of the entry closest to pos within radius or npos.
+	// If distance is given, it receives the distance to that entry.
+	uint32_t nearest(glm::ivec2 pos, float radius, float * distance = nullptr) const
+	{
+		int const r = int(radius) + 1;
+		auto const lo = cell_of(pos - glm::ivec2(r, r));
+		auto const hi = cell_of(pos + glm::ivec2(r, r));
+
+		uint32_t result = npos;
+		float dist = std::numeric_limits<float>::max();
+		for(int y = lo.y; y <= hi.y; y++)
+		{
+			for(int x = lo.x; x <= hi.x; x++)
+			{
+				auto it = cells.find(key_of(glm::ivec2(x, y)));
+				if(it == cells.end())
+					continue;
+				for(auto const & e : it->second)
+				{
+					auto d = glm::distance(glm::vec2(pos), glm::vec2(e.position));
+					if(d > dist)
+						continue;
+					if(d > radius)
+						continue;
+					result = e.id;
+					dist = d;
+				}
+			}
+		}
+		if(distance != nullptr)
+			*distance = dist;
+		return result;
+	}
+};
+
+#endif // SPATIALGRID_HPP
@@ -0,0 +1,50 @@
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread. push() fails instead of waiting when the queue is full.
+template<typename T, size_t Capacity>
+class SpscQueue
+{
+private:
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	T items[Capacity];
+
+	// Both only ever increase, on separate cache lines so the two
+	// threads do not keep stealing them from each other.
+	alignas(64) std::atomic<size_t> head;
+	alignas(64) std::atomic<size_t> tail;
+
+public:
+	SpscQueue() : items(), head(0), tail(0)
+	{
+	}
+
+	SpscQueue(SpscQueue const &) = delete;
+
+	bool push(T const & item)
+	{
+		auto const t = tail.load(std::memory_order_relaxed);
+		if(t - head.load(std::memory_order_acquire) == Capacity)
+			return false;
+		items[t & (Capacity - 1)] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T & item)
+	{
+		auto const h = head.load(std::memory_order_relaxed);
+		if(h == tail.load(std::memory_order_acquire))
+			return false;
+		item = items[h & (Capacity - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+};
+
+#endif // SPSCQUEUE_HPP
@@ -0,0 +1,88 @@
+#include "text.hpp"
+#include "renderqueue.hpp"
+#include "softraster.hpp"
+
+TextRenderer::TextRenderer(Handle<Sprite> font, glm::ivec2 glyphSize, char const * glyphs, size_t maxEntries) :
+	font(font), glyphSize(glyphSize), glyphs(glyphs),
+	maxEntries(maxEntries), uses(0), cache()
+{
+}
+
+TextRenderer::~TextRenderer()
+{
+	for(auto & entry : cache)
+	{
+		if(softRaster != nullptr)
+			softRaster->remove(entry.second.texture);
+		SDL_DestroyTexture(entry.second.texture);
+	}
+}
+
+int TextRenderer::width(std::string const & text) const
+{
+	return int(text.size()) * glyphSize.x;
+}
+
+void TextRenderer::add(SpriteBatch & batch, glm::ivec2 pos, std::string const & text, int style) const
+{
+	for(char c : text)
+	{
+		auto const column = glyphs.find(c);
+		if(column != std::string::npos)
+		{
+			SDL_Rect const glyph { int(column) * glyphSize.x, style * glyphSize.y, glyphSize.x, glyphSize.y };
+			batch.add(*font, pos, glyph);
+		}
+		pos.x += glyphSize.x;
+	}
+}
+
+void TextRenderer::draw(glm::ivec2 pos, std::string const & text, int style)
+{
+	if(text.empty())
+		return;
+
+	std::string key(1, char(style));
+	key += text;
+
+	auto it = cache.find(key);
+	if(it == cache.end())
+	{
+		if(cache.size() >= maxEntries)
+		{
+			auto lru = cache.begin();
+			for(auto i = cache.begin(); i != cache.end(); i++)
+			{
+				if(i->second.last_used < lru->second.last_used)
+					lru = i;
+			}
+			renderQueue.destroy_later(lru->second.texture);
+			cache.erase(lru);
+		}
+
+		glm::ivec2 const size(width(text), glyphSize.y);
+		auto texture = CreateRenderTarget(size.x, size.y);
+		SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+		{
+			QueueTargetGuard _g(texture);
+			renderQueue.clear(SDL_Color { 0, 0, 0, 0 });
+			renderQueue.set_layer(1);
+
+			SpriteBatch batch;
+			add(batch, glm::ivec2(), text, style);
+		}
+		it = cache.emplace(key, Entry { texture, size, 0 }).first;
+	}
+
+	auto & entry = it->second;
+	entry.last_used = ++uses;
+	SDL_Rect const rect { pos.x, pos.y, entry.size.x, entry.size.y };
+	renderQueue.copy(entry.texture, nullptr, rect);
+}
+
+void TextRenderer::clear()
+{
+	for(auto & entry : cache)
+		renderQueue.destroy_later(entry.second.texture);
+	cache.clear();
+}
@@ -0,0 +1,52 @@
+#ifndef TEXT_HPP
+#define TEXT_HPP
+
+#include "engine.h"
+#include "atlas.hpp"
+#include "resources.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+// Draws strings with a bitmap font: a sheet with one row of equally sized
+// glyphs per style. Strings drawn with draw() are rendered once into a
+// small texture, so text that does not change costs a single blit.
+class TextRenderer
+{
+private:
+	struct Entry
+	{
+		Image texture;
+		glm::ivec2 size;
+		uint64_t last_used;
+	};
+
+	Handle<Sprite> font;
+	glm::ivec2 glyphSize;
+	std::string glyphs;
+
+	size_t maxEntries;
+	uint64_t uses;
+	std::unordered_map<std::string, Entry> cache;
+
+public:
+	// glyphs lists the characters on the sheet from left to right
+	TextRenderer(Handle<Sprite> font, glm::ivec2 glyphSize, char const * glyphs, size_t maxEntries = 64);
+	TextRenderer(TextRenderer const &) = delete;
+	~TextRenderer();
+
+	int width(std::string const & text) const;
+
+	// Adds the glyphs of text with the top left corner at pos. Characters
+	// missing from the font leave a gap.
+	void add(SpriteBatch & batch, glm::ivec2 pos, std::string const & text, int style) const;
+
+	// Draws text with the top left corner at pos from the cache
+	void draw(glm::ivec2 pos, std::string const & text, int style);
+
+	// Drops all cached strings, needed after the font changed
+	void clear();
+};
+
+#endif // TEXT_HPP
@@ -0,0 +1,97 @@
+#ifndef TIMINGWHEEL_HPP
+#define TIMINGWHEEL_HPP
+
+#include <vector>
+#include <cstdint>
+
+// Hierarchical timing wheel over 32 bit ticks. Level 0 has one slot per
+// tick for the next 256 ticks, every further level covers 256 times the
+// range of the one below at 256 times coarser resolution. Entries move
+// down a level whenever the level below wraps around, so scheduling and
+// firing are O(1) and idle ticks only look at a single slot.
+template<typename T>
+class TimingWheel
+{
+private:
+	static int const bits = 8;
+	static uint32_t const slots = 1u << bits;
+	static int const levels = 4;
+
+	struct Entry
+	{
+		uint32_t due;
+		T value;
+	};
+
+	uint32_t current;
+	std::vector<Entry> wheel[levels][slots];
+	std::vector<Entry> scratch;
+
+	void insert(Entry const & e)
+	{
+		uint32_t const delta = e.due - current;
+		int level = 0;
+		while(level + 1 < levels && delta >= (1u << (bits * (level + 1))))
+			level++;
+		wheel[level][(e.due >> (bits * level)) & (slots - 1)].push_back(e);
+	}
+
+public:
+	TimingWheel() : current(0)
+	{
+	}
+
+	uint32_t now() const { return current; }
+
+	void clear(uint32_t now)
+	{
+		current = now;
+		for(auto & level : wheel)
+		{
+			for(auto & slot : level)
+				slot.clear();
+		}
+	}
+
+	// Entries due now or earlier fire on the next advance()
+	void schedule(uint32_t due, T const & value)
+	{
+		if(int32_t(due - current) <= 0)
+			due = current + 1;
+		insert(Entry { due, value });
+	}
+
+	// Moves to the next tick and calls fn(value) for every entry due
+	// then, in the order they were scheduled.
+	template<typename F>
+	void advance(F && fn)
+	{
+		current++;
+
+		// Cascade the upper levels that wrapped, highest first, so
+		// their entries can still fall through all levels below
+		for(int level = levels - 1; level > 0; level--)
+		{
+			if((current & ((1u << (bits * level)) - 1)) != 0)
+				continue;
+			auto & slot = wheel[level][(current >> (bits * level)) & (slots - 1)];
+			scratch.swap(slot);
+			for(auto const & e : scratch)
+				insert(e);
+			scratch.clear();
+		}
+
+		auto & slot = wheel[0][current & (slots - 1)];
+		scratch.swap(slot);
+		for(auto const & e : scratch)
+		{
+			if(e.due == current)
+				fn(e.value);
+			else
+				insert(e);
+		}
+		scratch.clear();
+	}
+};
+
+#endif // TIMINGWHEEL_HPP
@@ -0,0 +1,117 @@
+#include "trace.hpp"
+
+#include <cinttypes>
+
+TraceWriter::TraceWriter(char const * fileName, uint32_t seed, glm::ivec2 screen) :
+	file(fopen(fileName, "w"))
+{
+	if(file == nullptr)
+		die("Could not create trace file");
+	fprintf(file, "mlgtrace 1\nseed %" PRIu32 "\nscreen %d %d\n", seed, screen.x, screen.y);
+}
+
+TraceWriter::~TraceWriter()
+{
+	if(file != nullptr)
+		fclose(file);
+}
+
+void TraceWriter::event(uint64_t tick, SDL_Event const & ev, glm::ivec2 screen)
+{
+	int a = 0, b = 0, c = 0;
+	switch(ev.type)
+	{
+		case SDL_KEYDOWN:
+			a = ev.key.keysym.sym;
+			break;
+		case SDL_MOUSEBUTTONDOWN:
+		case SDL_MOUSEBUTTONUP:
+			a = ev.button.button;
+			b = ev.button.x;
+			c = ev.button.y;
+			break;
+		case SDL_MOUSEMOTION:
+			a = ev.motion.x;
+			b = ev.motion.y;
+			break;
+		case SDL_WINDOWEVENT:
+			a = screen.x;
+			b = screen.y;
+			break;
+		default:
+			return;
+	}
+	fprintf(file, "e %" PRIu64 " %" PRIu32 " %d %d %d\n", tick, ev.type, a, b, c);
+}
+
+void TraceWriter::finish(uint64_t tick)
+{
+	fprintf(file, "end %" PRIu64 "\n", tick);
+	if(fclose(file) != 0)
+		die("Could not write trace file");
+	file = nullptr;
+}
+
+TraceReader::TraceReader(char const * fileName) :
+	file(fopen(fileName, "r")),
+	_seed(0),
+	_screen(),
+	_end(0)
+{
+	if(file == nullptr)
+		die("Could not open trace file");
+	int version;
+	if(fscanf(file, "mlgtrace %d seed %" SCNu32 " screen %d %d", &version, &_seed, &_screen.x, &_screen.y) != 4)
+		die("Invalid trace file!");
+	if(version != 1)
+		die("Unsupported trace file version!");
+}
+
+TraceReader::~TraceReader()
+{
+	fclose(file);
+}
+
+bool TraceReader::next(uint64_t & tick, SDL_Event & ev, glm::ivec2 & screen)
+{
+	char kind[8];
+	if(fscanf(file, "%7s", kind) != 1)
+		die("Truncated trace file!");
+
+	if(strcmp(kind, "end") == 0)
+	{
+		if(fscanf(file, "%" SCNu64, &_end) != 1)
+			die("Invalid trace file!");
+		return false;
+	}
+	if(strcmp(kind, "e") != 0)
+		die("Invalid trace file!");
+
+	Uint32 type;
+	int a, b, c;
+	if(fscanf(file, "%" SCNu64 " %" SCNu32 " %d %d %d", &tick, &type, &a, &b, &c) != 5)
+		die("Invalid trace file!");
+
+	memset(&ev, 0, sizeof ev);
+	ev.type = type;
+	switch(type)
+	{
+		case SDL_KEYDOWN:
+			ev.key.keysym.sym = a;
+			break;
+		case SDL_MOUSEBUTTONDOWN:
+		case SDL_MOUSEBUTTONUP:
+			ev.button.button = Uint8(a);
+			ev.button.x = b;
+			ev.button.y = c;
+			break;
+		case SDL_MOUSEMOTION:
+			ev.motion.x = a;
+			ev.motion.y = b;
+			break;
+		case SDL_WINDOWEVENT:
+			screen = glm::ivec2(a, b);
+			break;
+	}
+	return true;
+}
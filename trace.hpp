@@ -0,0 +1,56 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include "engine.h"
+
+// Input traces for reproducible sessions. A trace is a text file:
+//
+//   mlgtrace 1
+//   seed <rng seed>
+//   screen <width> <height>
+//   e <tick> <event type> <a> <b> <c>
+//   ...
+//   end <tick>
+//
+// where tick is the number of game_update() calls before the event was
+// handled. Only the event fields the game looks at are stored.
+class TraceWriter
+{
+private:
+	FILE * file;
+
+public:
+	TraceWriter(char const * fileName, uint32_t seed, glm::ivec2 screen);
+	TraceWriter(TraceWriter const &) = delete;
+	~TraceWriter();
+
+	void event(uint64_t tick, SDL_Event const & ev, glm::ivec2 screen);
+
+	void finish(uint64_t tick);
+};
+
+class TraceReader
+{
+private:
+	FILE * file;
+	uint32_t _seed;
+	glm::ivec2 _screen;
+	uint64_t _end;
+
+public:
+	explicit TraceReader(char const * fileName);
+	TraceReader(TraceReader const &) = delete;
+	~TraceReader();
+
+	uint32_t seed() const { return _seed; }
+	glm::ivec2 screen() const { return _screen; }
+
+	// Only valid after next() returned false
+	uint64_t end() const { return _end; }
+
+	// Reads the next event. For window events, screen receives the
+	// window size at that time.
+	bool next(uint64_t & tick, SDL_Event & ev, glm::ivec2 & screen);
+};
+
+#endif // TRACE_HPP
@@ -0,0 +1,56 @@
+#ifndef TRIPLEBUFFER_HPP
+#define TRIPLEBUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free hand-over of the latest value from one writer thread to one
+// reader thread. The writer fills back() and publishes it, the reader
+// picks up the most recent publication with update() and reads front().
+// Neither side ever waits, values the reader was too slow for are skipped,
+// so back() holds an older value that has to be overwritten completely.
+template<typename T>
+class TripleBuffer
+{
+private:
+	// Set in middle when it holds a value the reader has not seen yet
+	static uint8_t const fresh = 4;
+
+	T buffers[3];
+	std::atomic<uint8_t> middle;
+	uint8_t writeIndex;
+	uint8_t readIndex;
+
+public:
+	TripleBuffer() : buffers(), middle(1), writeIndex(0), readIndex(2)
+	{
+	}
+
+	TripleBuffer(TripleBuffer const &) = delete;
+
+	T & back()
+	{
+		return buffers[writeIndex];
+	}
+
+	void publish()
+	{
+		writeIndex = middle.exchange(uint8_t(writeIndex | fresh), std::memory_order_acq_rel) & 3;
+	}
+
+	// Returns true if front() changed
+	bool update()
+	{
+		if((middle.load(std::memory_order_relaxed) & fresh) == 0)
+			return false;
+		readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & 3;
+		return true;
+	}
+
+	T const & front() const
+	{
+		return buffers[readIndex];
+	}
+};
+
+#endif // TRIPLEBUFFER_HPP
@@ -0,0 +1,133 @@
+#include "voices.hpp"
+
+#include <algorithm>
+
+VoiceManager::VoiceManager(int channels) :
+	voices(size_t(channels), Voice { nullptr, 0, 0 }),
+	configs(),
+	queued(),
+	counter(0),
+	replacementsMutex(),
+	replacements()
+{
+	Mix_AllocateChannels(channels);
+	queued.reserve(16);
+}
+
+VoiceManager::Config VoiceManager::config_of(Sound sound) const
+{
+	auto it = configs.find(sound);
+	if(it == configs.end())
+		return Config { 0, 2 };
+	return it->second;
+}
+
+void VoiceManager::configure(Sound sound, int priority, int maxVoices)
+{
+	configs[sound] = Config { priority, std::max(1, maxVoices) };
+}
+
+void VoiceManager::play(Sound sound)
+{
+	if(sound == nullptr)
+		return;
+	if(std::find(queued.begin(), queued.end(), sound) != queued.end())
+		return;
+	queued.push_back(sound);
+}
+
+int VoiceManager::pick_channel(Sound sound, Config const & config)
+{
+	int freeChannel = -1;
+	int oldestSame = -1;
+	int sameCount = 0;
+	int victim = -1;
+	for(int ch = 0; ch < int(voices.size()); ch++)
+	{
+		auto & v = voices[size_t(ch)];
+		if(v.sound != nullptr && !Mix_Playing(ch))
+			v.sound = nullptr;
+		if(v.sound == nullptr)
+		{
+			if(freeChannel < 0)
+				freeChannel = ch;
+			continue;
+		}
+
+		if(v.sound == sound)
+		{
+			sameCount++;
+			if(oldestSame < 0 || v.started < voices[size_t(oldestSame)].started)
+				oldestSame = ch;
+		}
+
+		if(v.priority > config.priority)
+			continue;
+		if(victim < 0)
+		{
+			victim = ch;
+			continue;
+		}
+		auto const & w = voices[size_t(victim)];
+		if(v.priority < w.priority || (v.priority == w.priority && v.started < w.started))
+			victim = ch;
+	}
+
+	if(sameCount >= config.maxVoices)
+		return oldestSame;
+	if(freeChannel >= 0)
+		return freeChannel;
+	return victim;
+}
+
+void VoiceManager::replace(Sound sound, Sound chunk)
+{
+	std::lock_guard<std::mutex> _l(replacementsMutex);
+	replacements.emplace_back(sound, chunk);
+}
+
+void VoiceManager::flush()
+{
+	std::vector<std::pair<Sound, Sound>> pending;
+	{
+		std::lock_guard<std::mutex> _l(replacementsMutex);
+		pending.swap(replacements);
+	}
+	for(auto & replacement : pending)
+	{
+		auto const sound = replacement.first;
+		auto const chunk = replacement.second;
+
+		// The audio callback must not see a half swapped chunk
+		SDL_LockAudio();
+		for(int ch = 0; ch < int(voices.size()); ch++)
+		{
+			if(Mix_GetChunk(ch) == sound)
+				Mix_HaltChannel(ch);
+		}
+		auto const volume = sound->volume;
+		std::swap(*sound, *chunk);
+		sound->volume = volume;
+		SDL_UnlockAudio();
+
+		Mix_FreeChunk(chunk);
+	}
+
+	for(auto sound : queued)
+	{
+		auto const config = config_of(sound);
+		int const ch = pick_channel(sound, config);
+		if(ch < 0)
+			continue;
+
+		if(voices[size_t(ch)].sound != nullptr)
+			Mix_HaltChannel(ch);
+		if(Mix_PlayChannel(ch, sound, 0) < 0)
+		{
+			voices[size_t(ch)].sound = nullptr;
+			continue;
+		}
+		voices[size_t(ch)] = Voice { sound, config.priority, ++counter };
+	}
+	queued.clear();
+}
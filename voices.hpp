@@ -0,0 +1,64 @@
+#ifndef VOICES_HPP
+#define VOICES_HPP
+
+#include "engine.h"
+
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <utility>
+
+// Owns the mixer channels and decides which sound gets one.
+//
+// play() only queues a sound; flush() starts everything queued since the
+// last flush, so the same sound triggered several times in one tick is
+// played once. A sound never plays on more than maxVoices channels at a
+// time, further requests restart its oldest voice. When all channels are
+// busy, the oldest voice of the lowest priority not above the new sound's
+// is stolen, otherwise the new sound is dropped.
+class VoiceManager
+{
+private:
+	struct Config
+	{
+		int priority;
+		int maxVoices;
+	};
+
+	struct Voice
+	{
+		Sound sound;
+		int priority;
+		unsigned long started;
+	};
+
+	std::vector<Voice> voices;
+	std::unordered_map<Sound, Config> configs;
+	std::vector<Sound> queued;
+	unsigned long counter;
+
+	// Replacement samples from other threads, applied by flush()
+	std::mutex replacementsMutex;
+	std::vector<std::pair<Sound, Sound>> replacements;
+
+	Config config_of(Sound sound) const;
+
+	int pick_channel(Sound sound, Config const & config);
+
+public:
+	explicit VoiceManager(int channels);
+	VoiceManager(VoiceManager const &) = delete;
+
+	// Sounds that were never configured have priority 0 and 2 voices
+	void configure(Sound sound, int priority, int maxVoices);
+
+	void play(Sound sound);
+
+	// Swaps the samples of chunk into sound on the next flush() and frees
+	// chunk then, so voices and handles keep their Sound. Thread safe.
+	void replace(Sound sound, Sound chunk);
+
+	void flush();
+};
+
+#endif // VOICES_HPP